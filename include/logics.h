@@ -11,6 +11,13 @@
 
 #include "z3++.h"
 #include <set>
+#include <map>
+#include <list>
+#include <tuple>
+#include <optional>
+#include <functional>
+#include <memory>
+#include <vector>
 #include <string>
 #include "AnalysisManager.h"
 #include "LinearAlgebra.h"
@@ -98,8 +105,178 @@ namespace ari_exe {
      */
     z3::expr eliminate_ite(const z3::expr& expr);
 
+    /**
+     * @brief A bounded memo table shared by the simplification helpers,
+     *        i.e., simplify, Logic::simplify and eliminate_ite.
+     *        It is implemented in singleton pattern.
+     * @details Entries are keyed by (kind, AST id of the input, AST id of the assumption).
+     *          Each entry keeps the input and the assumption alive,
+     *          so their ids cannot be recycled by z3 while they are cached.
+     *          The least recently used entry is evicted when the table is full.
+     *          Only expressions of the global context (AnalysisManager::get_ctx)
+     *          are cached, as AST ids are only unique within one context and
+     *          entries must not outlive the context they belong to.
+     */
+    class SimplifyCache {
+        public:
+            enum Kind {
+                CONTEXTUAL, // ari_exe::simplify(expr, assumption)
+                CNF,        // Logic::simplify
+                ELIM_ITE,   // eliminate_ite
+                NUM_KINDS,
+            };
+
+            ~SimplifyCache() = default;
+            SimplifyCache(const SimplifyCache&) = delete;
+            SimplifyCache& operator=(const SimplifyCache&) = delete;
+            static SimplifyCache* get_instance() { return instance; }
+
+            /**
+             * @brief get the cached result of the given input, if any
+             */
+            std::optional<z3::expr> lookup(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption = std::nullopt);
+
+            /**
+             * @brief record the result of the given input
+             */
+            void insert(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption, const z3::expr& result);
+
+            /**
+             * @brief drop all entries and reset the counters
+             */
+            void clear();
+
+            /**
+             * @brief set the maximal number of entries, 0 disables the cache
+             */
+            void set_capacity(size_t new_capacity);
+
+            size_t size() const { return entries.size(); }
+            size_t get_hits(Kind kind) const { return hits[kind]; }
+            size_t get_misses(Kind kind) const { return misses[kind]; }
+
+            /**
+             * @brief hit-rate counters of all kinds in a human readable form
+             */
+            std::string to_string() const;
+
+        private:
+            SimplifyCache();
+            static SimplifyCache* instance;
+
+            using key_ty = std::tuple<int, unsigned, unsigned>;
+
+            struct Entry {
+                z3::expr input;
+                std::optional<z3::expr> assumption;
+                z3::expr result;
+            };
+
+            using entry_list = std::list<std::pair<key_ty, Entry>>;
+
+            static key_ty make_key(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption);
+
+            static bool is_cacheable(const z3::expr& input);
+
+            void evict();
+
+            // entries in the order of use, the most recently used one comes first
+            entry_list entries;
+
+            std::map<key_ty, entry_list::iterator> index;
+
+            size_t capacity;
+
+            size_t hits[NUM_KINDS] = {};
+            size_t misses[NUM_KINDS] = {};
+    };
+
+    /**
+     * @brief A thread-local pool of solvers for short-lived queries.
+     * @details Constructing a z3::solver sets up tactics and parameter objects,
+     *          so helpers lease a solver from the pool instead. The lease asserts in a scope
+     *          pushed on the solver, and pops back to the base level when it goes out of scope,
+     *          so the solver keeps its internal state for the next lease.
+     *          Only solvers of the global context (AnalysisManager::get_ctx) are pooled,
+     *          leases on other contexts own a fresh solver.
+     *          Solvers are returned without parameters being reset,
+     *          so leased solvers must not be configured with set().
+     */
+    class SolverPool {
+        public:
+            /**
+             * @brief an RAII handle of a solver with no assertions
+             */
+            class Lease {
+                public:
+                    explicit Lease(z3::context& z3ctx);
+                    ~Lease();
+                    Lease(const Lease&) = delete;
+                    Lease& operator=(const Lease&) = delete;
+
+                    z3::solver& operator*() { return *solver; }
+                    z3::solver* operator->() { return solver.get(); }
+
+                private:
+                    std::unique_ptr<z3::solver> solver;
+                    bool pooled;
+            };
+
+            /**
+             * @brief an RAII push/pop scope on a solver
+             */
+            class Scope {
+                public:
+                    explicit Scope(z3::solver& solver): solver(solver) { solver.push(); }
+                    ~Scope() { solver.pop(); }
+                    Scope(const Scope&) = delete;
+                    Scope& operator=(const Scope&) = delete;
+
+                private:
+                    z3::solver& solver;
+            };
+
+            static SolverPool& get_instance();
+
+            /**
+             * @brief drop all idle solvers and reset the counters
+             */
+            void clear();
+
+            size_t get_constructed() const { return constructed; }
+            size_t get_reused() const { return reused; }
+
+            /**
+             * @brief construction counters in a human readable form
+             */
+            std::string to_string() const;
+
+        private:
+            SolverPool() = default;
+
+            std::unique_ptr<z3::solver> acquire(z3::context& z3ctx, bool& pooled);
+
+            void release(std::unique_ptr<z3::solver> solver);
+
+            std::vector<std::unique_ptr<z3::solver>> idle;
+
+            size_t constructed = 0;
+            size_t reused = 0;
+    };
+
     class Logic {
         public:
+            /**
+             * @brief the clause budget is taken from ARITHEXE_NORMAL_FORM_LIMIT if set
+             */
+            Logic();
+
+            /**
+             * @param clause_limit the maximal number of clauses (cubes) produced by
+             *        to_cnf (to_dnf), 0 means unbounded
+             */
+            explicit Logic(size_t clause_limit);
+
             /**
              * @brief check if this expression is atomic in the theory
              */
@@ -112,14 +289,39 @@ namespace ari_exe {
 
             /**
              * @brief convert the formula into CNF
+             * @details stops after clause_limit clauses, in which case the result
+             *          is weaker than fml and is_truncated() becomes true
              */
             z3::expr_vector to_cnf(const z3::expr& fml);
 
             /**
              * @brief convert the formula into DNF
+             * @details stops after clause_limit cubes, in which case the result
+             *          is stronger than fml and is_truncated() becomes true
              */
             z3::expr_vector to_dnf(const z3::expr& fml);
 
+            /**
+             * @brief enumerate the CNF clauses of fml lazily
+             * @param visit called on each clause, returning false stops the enumeration
+             * @return true if all clauses have been visited
+             */
+            bool for_each_cnf_clause(const z3::expr& fml, const std::function<bool(const z3::expr&)>& visit);
+
+            /**
+             * @brief enumerate the DNF cubes of fml lazily
+             * @param visit called on each cube, returning false stops the enumeration
+             * @return true if all cubes have been visited
+             */
+            bool for_each_dnf_cube(const z3::expr& fml, const std::function<bool(const z3::expr&)>& visit);
+
+            /**
+             * @brief whether some normal form computed by this object hit the clause budget
+             */
+            bool is_truncated() const { return truncated; }
+
+            size_t get_clause_limit() const { return clause_limit; }
+
             /**
              * @brief simplify the formula using to_cnf
              */
@@ -166,6 +368,16 @@ namespace ari_exe {
             z3::expr_vector collect_aux_vars(const z3::expr& e);
 
         private:
+            size_t clause_limit;
+
+            bool truncated = false;
+
+            /**
+             * @brief collect at most clause_limit CNF clauses of fml
+             * @return true if the CNF is complete
+             */
+            bool to_cnf_bounded(const z3::expr& fml, z3::expr_vector& clauses);
+
             void atoms_rec(const z3::expr& t, std::set<std::string>& visited, z3::expr_vector& atms);
             
             /**
@@ -193,12 +405,16 @@ namespace ari_exe {
 
     class LinearLogic: public Logic {
         public:
+            using Logic::Logic;
+
             /**
              * @brief Assuming vars are piecewise linear expression of others,
              *        this function computes this expressions
              * @param constraints quantifer-free constraints
              * @param vars variables to be solved
-             * @return piecewise linear expressions of vars entailed by the constraints
+             * @return piecewise linear expressions of vars entailed by the constraints,
+             *         empty if they cannot be computed, e.g., the DNF of the
+             *         constraints exceeds the clause budget
              */
             z3::expr_vector solve_vars(const z3::expr& constraints, const z3::expr_vector& vars);
 
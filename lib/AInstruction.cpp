@@ -3,9 +3,11 @@
 
 #include "z3++.h"
 #include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugProgramInstruction.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <optional>
@@ -53,6 +55,77 @@ source_variable(llvm::Value* value) {
     }
     return std::nullopt;
 }
+
+// collect the types accessed through ptr, following the pointer through casts and the stack slots it is stored to
+void collect_accessed_types(llvm::Value* ptr, std::set<llvm::Value*>& visited, std::vector<llvm::Type*>& types) {
+    if (!visited.insert(ptr).second) return;
+    for (auto user : ptr->users()) {
+        if (auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(user)) {
+            if (gep->getPointerOperand() == ptr) types.push_back(gep->getSourceElementType());
+        } else if (auto load = llvm::dyn_cast<llvm::LoadInst>(user)) {
+            types.push_back(load->getType());
+        } else if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+            if (store->getPointerOperand() == ptr) {
+                types.push_back(store->getValueOperand()->getType());
+            } else if (auto slot = llvm::dyn_cast<llvm::AllocaInst>(store->getPointerOperand())) {
+                // the pointer is kept in a local variable, e.g., int* a = malloc(...) without optimization
+                for (auto slot_user : slot->users()) {
+                    if (auto slot_load = llvm::dyn_cast<llvm::LoadInst>(slot_user)) {
+                        collect_accessed_types(slot_load, visited, types);
+                    }
+                }
+            }
+        } else if (llvm::isa<llvm::BitCastInst>(user)) {
+            collect_accessed_types(user, visited, types);
+        }
+    }
+}
+
+/**
+ * @brief the type of the objects in a heap allocation, inferred from how the returned pointer is used.
+ *        Arrays of rows, e.g., int (*a)[M] = malloc(...), give array types.
+ * @return nullptr if the pointer is never accessed
+ */
+llvm::Type* infer_allocated_type(llvm::CallInst* call_inst) {
+    std::set<llvm::Value*> visited;
+    std::vector<llvm::Type*> types;
+    collect_accessed_types(call_inst, visited, types);
+    if (types.empty()) return nullptr;
+    auto& layout = call_inst->getModule()->getDataLayout();
+    for (auto type : types) {
+        if (layout.getTypeAllocSize(type) != layout.getTypeAllocSize(types[0])) {
+            spdlog::warn("Heap object {} is accessed with different widths, modeled with the first one",
+                         call_inst->getName().str());
+            break;
+        }
+    }
+    return types[0];
+}
+
+/**
+ * @brief the scalar type of the elements of the memory object created by value
+ */
+llvm::Type* get_element_type(llvm::Value* value) {
+    llvm::Type* type = nullptr;
+    if (auto alloca_inst = llvm::dyn_cast<llvm::AllocaInst>(value)) {
+        type = alloca_inst->getAllocatedType();
+    } else if (auto gv = llvm::dyn_cast<llvm::GlobalVariable>(value)) {
+        type = gv->getValueType();
+    } else if (auto call_inst = llvm::dyn_cast<llvm::CallInst>(value)) {
+        type = infer_allocated_type(call_inst);
+    }
+    while (type && type->isArrayTy()) {
+        type = type->getArrayElementType();
+    }
+    return type;
+}
+
+// size in bytes of an element of the memory object created by value, 4 (int) if unknown
+uint64_t get_element_bytes(llvm::Value* value, const llvm::DataLayout& layout) {
+    auto type = get_element_type(value);
+    if (type == nullptr || !type->isSized()) return 4;
+    return layout.getTypeAllocSize(type);
+}
 } // namespace
 
 std::string llvm_value_to_string(const llvm::Value& value) {
@@ -62,18 +135,45 @@ std::string llvm_value_to_string(const llvm::Value& value) {
     return stream.str();
 }
 
-std::map<llvm::Instruction*, AInstruction*>
+std::unordered_map<llvm::Instruction*, AInstruction*>
 AInstruction::cached_instructions;
 
-std::map<llvm::Value*, int>
-AInstructionCall::value_counter;
-
 AInstruction*
 AInstruction::create(llvm::Instruction* inst) {
-    if (cached_instructions.find(inst) != cached_instructions.end()) {
-        return cached_instructions.at(inst);
+    auto it = cached_instructions.find(inst);
+    if (it != cached_instructions.end()) {
+        return it->second;
     }
 
+    auto func = inst->getFunction();
+    if (func != nullptr) {
+        // create the whole function, so that stepping through it never looks up the cache
+        cached_instructions.reserve(cached_instructions.size() + func->getInstructionCount());
+        for (auto& bb : *func) {
+            AInstruction* prev = nullptr;
+            for (auto& cur : bb) {
+                auto cur_it = cached_instructions.find(&cur);
+                auto cur_ainst = cur_it != cached_instructions.end() ? cur_it->second : create_one(&cur);
+                // unsupported instructions are only reported if they are executed
+                if (cur_ainst) cached_instructions.emplace(&cur, cur_ainst);
+                if (prev) prev->next = cur_ainst;
+                prev = cur_ainst;
+            }
+        }
+        it = cached_instructions.find(inst);
+        if (it != cached_instructions.end()) {
+            return it->second;
+        }
+    }
+
+    auto res = create_one(inst);
+    assert(res && "Unspported instruction type");
+    cached_instructions.emplace(inst, res);
+    return res;
+}
+
+AInstruction*
+AInstruction::create_one(llvm::Instruction* inst) {
     AInstruction* res = nullptr;
     if (inst->isDebugOrPseudoInst()) {
         res = new AInstructionDebug(inst);
@@ -106,10 +206,7 @@ AInstruction::create(llvm::Instruction* inst) {
         res = new AInstructionGEP(gep_inst);
     } else if (auto alloca_inst = llvm::dyn_cast_or_null<llvm::AllocaInst>(inst)) {
         res = new AInstructionAlloca(alloca_inst);
-    } else {
-        assert(false && "Unspported instruction type");
     }
-    cached_instructions.insert_or_assign(inst, res);
     return res;
 }
 
@@ -141,8 +238,12 @@ AInstruction::execute(rec_state_ptr state) {
 AInstruction*
 AInstruction::get_next_instruction() {
     // auto next_inst = inst->getNextNonDebugInstruction();
+    if (next) {
+        return next;
+    }
     auto next_inst = inst->getNextNode();
     if (next_inst) {
+        // the function has been changed after it was created
         return create(next_inst);
     }
     return nullptr;
@@ -304,7 +405,9 @@ AInstructionCall::execute_normal(state_ptr state) {
     // check if the function is recursive and not yet summarized
     auto ret_type = called_func->getReturnType();
     bool is_visited = Cache::get_instance()->is_visited(called_func);
-    if (!is_visited && !state->is_summarizing() && is_recursive(called_func) && !State::func_summaries->get_value(called_func).has_value()) {
+    // FunctionSummarizer only summarizes loop free functions
+    if (!is_visited && !state->is_summarizing() && is_recursive(called_func) && !State::func_summaries->get_value(called_func).has_value() &&
+        AnalysisManager::get_instance()->get_LI(called_func).empty()) {
         Cache::get_instance()->mark_visited(called_func);
         auto summary = summarize_complete(state->z3ctx);
         if (summary.has_value()) {
@@ -377,8 +480,8 @@ AInstructionCall::execute_normal(state_ptr state) {
             auto arg_obj = new_state->memory.get_object_pointed_by(arg);
             auto arg_value = arg_obj->read().as_expr();
             initial_values.push_back(arg_value);
-            auto name = arg->getName() + "_unknwon_over_approximated" + std::to_string(value_counter[inst]++);
-            auto unknown = z3ctx.int_const(name.str().c_str());
+            auto name = arg->getName().str() + "_unknwon_over_approximated" + std::to_string(AnalysisManager::get_names().next_id(inst));
+            auto unknown = z3ctx.int_const(name.c_str());
             unknowns.push_back(unknown);
             arg_obj->write(unknown);
         }
@@ -407,7 +510,7 @@ AInstructionCall::execute_normal(state_ptr state) {
         auto arg = call_inst->getArgOperand(i);
         auto param = called_func->getArg(i);
         if (param->getType()->isPointerTy()) {
-            auto target_obj = state->memory.get_object(arg);
+            auto target_obj = state->memory.peek_object(arg);
             // auto addr = new_state->memory.allocate(param, target_obj->get_address());
             new_state->memory.put_temp(param, target_obj->get_ptr_value());
         } else {
@@ -435,23 +538,23 @@ AInstructionCall::execute_cache(state_ptr state) {
     }
 
     auto cache = Cache::get_instance();
-    auto model = state->get_model();
-    param_list_ty args;
+    std::vector<Expression> arg_values;
     for (int i = 0; i < call_inst->arg_size(); i++) {
-        auto arg = call_inst->getArgOperand(i);
-        auto state_value = state->evaluate(arg);
-        auto concrete_value = model.eval(state_value.as_expr(), true);
-        if (!state->is_concrete(state_value, concrete_value)) {
-            return nullptr;
-        }
-        args.push_back(concrete_value.as_int64());
+        arg_values.push_back(state->evaluate(call_inst->getArgOperand(i)));
+    }
+    auto concrete_args = state->get_concrete_ints(arg_values);
+    if (!concrete_args.has_value()) return nullptr;
+    param_list_ty args;
+    for (auto& arg : *concrete_args) {
+        args.push_back(*Cache::from_numeral(arg));
     }
     auto cached_value = cache->get_func_value(called_func, args);
-    if (cached_value.has_value()) {
+    // the executor has no aggregate values, so only scalar results are cached
+    if (cached_value.has_value() && cached_value->size() == 1) {
         // if the function is cached, return the cached value
         state_ptr new_state = std::make_shared<State>(*state);
         auto& z3ctx = state->z3ctx;
-        auto value = z3ctx.int_val(cached_value.value());
+        auto value = Cache::to_numeral(z3ctx, cached_value->front());
         // new_state->memory.allocate(inst, value);
         new_state->memory.put_temp(inst, value);
         new_state->step_pc();
@@ -520,7 +623,7 @@ AInstructionCall::execute_unknown(state_ptr state) {
     Expression result(z3ctx);
 
     // external function value is unknown, so symbolic
-    auto name = "ari_" + inst->getName().str() + "_unknown_" + std::to_string(value_counter[inst]++);
+    auto name = AnalysisManager::get_names().fresh_name(inst, "_unknown_");
     auto ret_type = call_inst->getType();
 
     if (ret_type->isIntegerTy()) {
@@ -601,17 +704,55 @@ AInstructionCall::execute_memcpy(state_ptr state) {
     auto dst = call_inst->getArgOperand(0);
     auto src = call_inst->getArgOperand(1);
     auto len = call_inst->getArgOperand(2);
-
-    auto len_value = state->evaluate(len).as_expr();
-    auto const_len_value = len_value.as_int64() / 4; // ensure it is concrete
+    auto& z3ctx = state->z3ctx;
+    auto& layout = call_inst->getModule()->getDataLayout();
 
     state_ptr new_state = std::make_shared<State>(*state);
     auto dst_obj = new_state->memory.get_object_pointed_by(dst);
-    auto src_obj = new_state->memory.get_object_pointed_by(src);
-    for (int i = 0; i < const_len_value; i++) {
-        Expression idx(new_state->z3ctx.int_val(i));
-        auto v = src_obj->read({idx}).as_expr();
-        dst_obj->write({idx}, v);
+    auto src_obj = new_state->memory.peek_object_pointed_by(src);
+    assert(dst_obj && src_obj && "Objects of memcpy must exist");
+
+    // the content of dst is unknown after an unsupported copy
+    auto havoc_dst = [&]() {
+        auto name = AnalysisManager::get_names().fresh_name(inst, "_memcpy_");
+        z3::sort_vector domain(z3ctx);
+        for (unsigned i = 0; i < dst_obj->get_indices().size(); i++) domain.push_back(z3ctx.int_sort());
+        auto f = z3ctx.function(name.c_str(), domain, z3ctx.int_sort());
+        dst_obj->write(Expression(f(dst_obj->get_indices())));
+        new_state->step_pc();
+        return new_state;
+    };
+
+    auto elem_bytes = get_element_bytes(dst_obj->get_llvm_value(), layout);
+    if (elem_bytes != get_element_bytes(src_obj->get_llvm_value(), layout)) {
+        spdlog::warn("memcpy between arrays of different element widths is not supported");
+        return havoc_dst();
+    }
+    auto len_value = state->evaluate(len);
+    auto count = len_value / Expression(z3ctx.int_val(elem_bytes));
+
+    // the copy starts from the elements pointed by dst and src,
+    // which are only known for pointers into 1-d arrays
+    auto start_of = [&](llvm::Value* ptr, const MemoryObject* obj) {
+        auto offset = new_state->memory.peek_object(ptr)->get_ptr_value().offset;
+        if (obj->get_sizes().size() == 1 && offset.size() == 1) return offset[0];
+        return Expression(z3ctx.int_val(0));
+    };
+    auto dst_start = start_of(dst, dst_obj);
+    auto src_start = start_of(src, src_obj);
+
+    if (!dst_obj->copy_range(*src_obj, src_start, dst_start, count)) {
+        // fall back to element-wise copy, which requires a concrete length
+        auto count_expr = count.as_expr().simplify();
+        if (!count_expr.is_numeral()) {
+            spdlog::warn("memcpy of symbolic length between arrays of different shapes is not supported");
+            return havoc_dst();
+        }
+        for (int64_t i = 0; i < count_expr.get_numeral_int64(); i++) {
+            Expression idx(z3ctx.int_val(i));
+            auto v = src_obj->read({src_start + idx});
+            dst_obj->write({dst_start + idx}, v);
+        }
     }
 
     new_state->step_pc();
@@ -624,10 +765,18 @@ AInstructionCall::execute_malloc(state_ptr state) {
     auto call_inst = dyn_cast<llvm::CallInst>(inst);
     auto size_bytes = call_inst->arg_begin()->get();
     auto size_bytes_expr = state->evaluate(size_bytes);
-    // TODO: assume it an integer array and the size of an int is 32 bits;
-    // TODO: assume it is 1-d
-    z3::expr_vector dims(state->z3ctx);
-    dims.push_back((size_bytes_expr / state->z3ctx.int_val(4)).as_expr().simplify());
+    auto& z3ctx = state->z3ctx;
+    auto& layout = call_inst->getModule()->getDataLayout();
+
+    // the outermost dimension is the number of allocated objects,
+    // and objects that are arrays themselves give the inner dimensions
+    z3::expr_vector dims(z3ctx);
+    auto allocated_type = infer_allocated_type(call_inst);
+    uint64_t object_bytes = allocated_type && allocated_type->isSized() ? layout.getTypeAllocSize(allocated_type) : 4;
+    dims.push_back((size_bytes_expr / Expression(z3ctx.int_val(object_bytes))).as_expr().simplify());
+    for (auto type = allocated_type; type && type->isArrayTy(); type = type->getArrayElementType()) {
+        dims.push_back(z3ctx.int_val(type->getArrayNumElements()));
+    }
     auto new_state = std::make_shared<State>(*state);
     new_state->memory.heap_alloca(call_inst, dims);
     new_state->step_pc();
@@ -669,7 +818,7 @@ AInstructionCall::execute_naively(state_ptr state) {
     for (int i = 0; i < num_args; i++) {
         auto arg = call_inst->getArgOperand(i);
         if (arg->getType()->isPointerTy()) {
-            auto arg_value = state->memory.get_object(arg);
+            auto arg_value = state->memory.peek_object(arg);
             args.push_back(arg_value->get_ptr_value().base.as_expr());
         } else {
             auto arg_value = state->evaluate(arg);
@@ -726,6 +875,17 @@ AInstructionBranch::execute(rec_state_ptr state) {
     return _execute(state);
 }
 
+void
+AInstructionBranch::count_symbolic_exit(llvm::BasicBlock* block, const state_list& forked_states) {
+    auto& LI = AnalysisManager::get_instance()->get_LI(block->getParent());
+    for (auto loop = LI.getLoopFor(block); loop; loop = loop->getParentLoop()) {
+        if (!AInstructionPhi::failed_loops.count(loop) || !loop->isLoopExiting(block)) continue;
+        for (auto& forked_state : forked_states) {
+            if (loop->contains(forked_state->pc->get_block())) forked_state->symbolic_exits.insert(loop);
+        }
+    }
+}
+
 template<typename state_ty>
 state_list_base<state_ty>
 AInstructionBranch::_execute(std::shared_ptr<state_ty> state) {
@@ -738,6 +898,16 @@ AInstructionBranch::_execute(std::shared_ptr<state_ty> state) {
         auto cond = branch_inst->getCondition();
         auto cond_value = state->evaluate(cond);
 
+        if (auto concrete_cond = cond_value.get_concrete_truth()) {
+            // only one successor is feasible, so neither fork nor query the solver
+            auto taken_block = branch_inst->getSuccessor(*concrete_cond ? 0 : 1);
+            auto taken_pc = AInstruction::create(&*taken_block->instructionsWithoutDebug().begin());
+            auto taken_state = std::make_shared<state_ty>(*state);
+            taken_state->trace = new_trace;
+            taken_state->step_pc(taken_pc);
+            return {taken_state};
+        }
+
         auto true_block = branch_inst->getSuccessor(0);
         auto true_pc = AInstruction::create(&*true_block->instructionsWithoutDebug().begin());
         auto true_state = std::make_shared<state_ty>(*state);
@@ -756,6 +926,10 @@ AInstructionBranch::_execute(std::shared_ptr<state_ty> state) {
         false_state->append_path_condition(!cond_value);
         false_state->step_pc(false_pc);
 
+        if constexpr (std::is_same_v<state_ty, State>) {
+            count_symbolic_exit(branch_inst->getParent(), {true_state, false_state});
+        }
+
         new_states.push_back(true_state);
         new_states.push_back(false_state);
     } else {
@@ -780,7 +954,7 @@ AInstructionReturn::execute(state_ptr state) {
     auto ret = dyn_cast<llvm::ReturnInst>(inst);
 
     state_ptr new_state = std::make_shared<State>(*state);
-    auto& frame = new_state->memory.pop_frame();
+    auto frame = new_state->memory.pop_frame();
 
     auto ret_value = ret->getReturnValue();
     new_state->step_pc(frame.prev_pc);
@@ -802,19 +976,19 @@ void
 AInstructionReturn::cache_func_value(state_ptr state, const Expression& result) {
     auto cache_instance = Cache::get_instance();
     auto& top_frame = state->memory.top_frame();
-    param_list_ty args;
-
-    auto model = state->get_model();
-    auto concrete_result = model.eval(result.as_expr(), false);
-    if (!state->is_concrete(result, concrete_result)) return;
 
+    // the result first, then the arguments
+    std::vector<Expression> values{result};
     for (auto& param : top_frame.func->args()) {
-        auto arg_value = state->evaluate(&param);
-        auto concrete_value = model.eval(arg_value.as_expr(), true);
-        if (!state->is_concrete(arg_value, concrete_value)) return;
-        args.push_back(concrete_value.as_int64());
+        values.push_back(state->evaluate(&param));
+    }
+    auto concrete_values = state->get_concrete_ints(values);
+    if (!concrete_values.has_value()) return;
+    param_list_ty args;
+    for (auto it = concrete_values->begin() + 1; it != concrete_values->end(); ++it) {
+        args.push_back(*Cache::from_numeral(*it));
     }
-    cache_instance->cache_func_value(top_frame.func, args, concrete_result.as_int64());
+    cache_instance->cache_func_value(top_frame.func, args, {*Cache::from_numeral(concrete_values->front())});
 }
 
 std::vector<state_ptr>
@@ -869,6 +1043,29 @@ AInstructionPhi::execute(state_ptr state) {
         }
     }
 
+    // unroll loops that cannot be summarized up to a bound, and prove the rest of them by k-induction
+    if (loop && failed_loops.count(loop) && !state->is_summarizing() && phi_inst == &*loop->getHeader()->phis().begin()) {
+        state_ptr unrolled_state = std::make_shared<State>(*state);
+        auto& iterations = unrolled_state->unrolled_iterations[loop];
+        // iterations whose exit is decided by concrete conditions end by themselves, so they are not counted
+        bool forked = unrolled_state->symbolic_exits.erase(loop) > 0;
+        if (!loop->contains(state->trace.back())) {
+            iterations = 0;
+        } else if (forked) {
+            iterations++;
+        }
+        if (iterations >= LoopInduction::get_unroll_depth()) {
+            auto header_name = loop->getHeader()->getName().str();
+            spdlog::info("Unrolled loop {} {} times, proving the rest by k-induction", header_name, iterations);
+            auto exit_states = LoopInduction(loop, state).run(LoopInduction::get_induction_depth());
+            if (exit_states.has_value()) return *exit_states;
+            spdlog::info("Cannot prove loop {}, cutting the path", header_name);
+            unrolled_state->status = State::BOUNDED;
+            return {unrolled_state};
+        }
+        state = unrolled_state;
+    }
+
     auto prev_block = state->trace.back();
     llvm::Value* selected_value = phi_inst->getIncomingValueForBlock(prev_block);
     auto selected_value_expr = state->evaluate(selected_value);
@@ -1040,8 +1237,7 @@ AInstructionPhi::execute_if_summarizable(state_ptr state) {
     if (summary->is_over_approximated()) {
         for (auto& inst : *header) {
             if (auto phi = llvm::dyn_cast_or_null<llvm::PHINode>(&inst)) {
-                auto name = get_z3_name(phi->getName().str());
-                auto phi_expr = new_state->z3ctx.int_const(name.c_str());
+                auto phi_expr = AnalysisManager::get_names().int_const(phi);
                 auto initial_value = phi->getIncomingValueForBlock(entering_block);
                 auto initial_value_expr = new_state->evaluate(initial_value);
                 auto evaluated_value = summary->evaluate_expr(phi_expr);
@@ -1071,43 +1267,55 @@ AInstructionPhi::execute_if_summarizable(state_ptr state) {
         z3::expr_vector args(z3ctx);
         for (auto& inst : *header) {
             if (auto phi = llvm::dyn_cast_or_null<llvm::PHINode>(&inst)) {
-                auto name = get_z3_name(phi->getName().str());
-                auto phi_expr = z3ctx.int_const(name.c_str());
+                auto phi_expr = AnalysisManager::get_names().int_const(phi);
                 args.push_back(phi_expr);
             } else if (auto store_inst = llvm::dyn_cast_or_null<llvm::StoreInst>(&inst)) {
                 auto ptr = store_inst->getPointerOperand();
-                auto name = get_z3_name(ptr->getName().str());
-                auto ptr_expr = z3ctx.int_const(name.c_str());
+                auto ptr_expr = AnalysisManager::get_names().int_const(ptr);
                 args.push_back(ptr_expr);
             }
         }
-        auto arrays_ptr = state->memory.get_arrays();
+        auto arrays_ptr = state->memory.peek_arrays();
         for (int i = 0; i < arrays_ptr.size(); i++) {
             // for each array, we need to get the signature
             auto array_ptr = arrays_ptr[i];
             args.push_back(array_ptr->get_signature());
         }
-        z3::expr_vector closed_forms = summary->evaluate(args);
-        // auto phi_it = header->phis().begin();
-        auto modified_values = summary->get_modified_values();
-        for (int i = 0; i < closed_forms.size(); i++) {
-            auto modified_value = modified_values[i];
-            auto N = summary->get_N();
+        auto N = summary->get_N();
+        // with a concrete number of iterations, the values at the exit are usually computed natively,
+        // and the closed forms are only substituted if they are not
+        std::optional<z3::expr_vector> values;
+        if (N.has_value()) {
+            values = summary->evaluate_at(args, manager->get_ind_var(), N.value());
+        }
+        if (!values.has_value()) {
+            values = summary->evaluate(args);
             if (N.has_value()) {
                 z3::expr_vector src(z3ctx);
                 z3::expr_vector dst(z3ctx);
                 src.push_back(manager->get_ind_var());
                 dst.push_back(N.value());
+                z3::expr_vector exit_values(z3ctx);
+                for (auto closed_form : *values) exit_values.push_back(closed_form.substitute(src, dst));
+                values = exit_values;
+            }
+        }
+        // auto phi_it = header->phis().begin();
+        auto modified_values = summary->get_modified_values();
+        for (int i = 0; i < values->size(); i++) {
+            auto modified_value = modified_values[i];
+            auto value = (*values)[i];
+            if (N.has_value()) {
                 // new_state->write(modified_value, closed_forms[i].substitute(src, dst));
                 // new_state->memory.allocate(modified_value, closed_forms[i].substitute(src, dst));
                 if (auto obj = new_state->memory.get_object_pointed_by(modified_value)) {
-                    obj->write(closed_forms[i].substitute(src, dst));
+                    obj->write(value);
                 } else {
-                    new_state->memory.put_temp(modified_value, closed_forms[i].substitute(src, dst));
+                    new_state->memory.put_temp(modified_value, value);
                 }
 
             } else {
-                new_state->memory.put_temp(modified_value, closed_forms[i]);
+                new_state->memory.put_temp(modified_value, value);
             }
         }
     }
@@ -1151,6 +1359,14 @@ AInstructionSelect::_execute(std::shared_ptr<state_ty> state) {
     auto cond = select_inst->getCondition();
     auto cond_value = state->evaluate(cond);
 
+    if (auto concrete_cond = cond_value.get_concrete_truth()) {
+        auto selected_value = *concrete_cond ? select_inst->getTrueValue() : select_inst->getFalseValue();
+        auto selected_state = std::make_shared<state_ty>(*state);
+        selected_state->memory.put_temp(inst, selected_state->evaluate(selected_value));
+        selected_state->step_pc();
+        return {selected_state};
+    }
+
     auto true_value = select_inst->getTrueValue();
     auto true_value_expr = state->evaluate(true_value);
     auto true_state = std::make_shared<state_ty>(*state);
@@ -1191,42 +1407,14 @@ AInstruction::get_block() {
     return inst->getParent();
 }
 
-static MemoryAddress_ty
-parse_ptr(const MemoryObjectPtr ptr, state_ptr state) {
-    assert(ptr->is_pointer() && "Pointer object expected");
-    auto pointed_addr = ptr->get_ptr_value();
-    auto pointed_obj = state->memory.get_object(pointed_addr);
-    if (!pointed_obj->is_pointer()) {
-        return pointed_addr;
-    }
-    auto addr = parse_ptr(pointed_obj, state);
-    for (auto& offset : pointed_addr.offset) {
-        addr.offset.push_back(offset);
-    }
-    return addr;
-}
-
 static MemoryAddress_ty
 parse_gep(llvm::GetElementPtrInst* gep, state_ptr state) {
     // This function parses the GEP instruction and returns the memory address
     // it points to, based on the operands and the current state.
-    auto& z3ctx = state->z3ctx;
-    auto ptr_operand = gep->getPointerOperand();
-    auto pointed_obj = state->memory.get_object_pointed_by(ptr_operand);
-
-    std::vector<Expression> offsets;
-
-    MemoryAddress_ty addr;
-    if (!pointed_obj->is_pointer()) {
-        auto ptr_obj = state->memory.get_object(ptr_operand);
-        addr = ptr_obj->get_ptr_value();
-    } else {
-        addr = parse_ptr(pointed_obj, state);
-    }
-
+    auto addr = state->memory.resolve(gep->getPointerOperand());
+    addr.offset.reserve(addr.offset.size() + gep->getNumIndices());
     for (auto& idx : gep->indices()) {
-        auto idx_value = state->evaluate(idx.get());
-        addr.offset.push_back(idx_value);
+        addr.offset.push_back(state->evaluate(idx.get()));
     }
     return addr;
 }
@@ -1237,8 +1425,8 @@ AInstructionLoad::execute(state_ptr state) {
     auto ptr = load_inst->getPointerOperand();
     state_ptr new_state = std::make_shared<State>(*state);
 
-    auto addr = parse_ptr(new_state->memory.get_object(ptr), new_state);
-    auto pointed_obj = new_state->memory.get_object(addr);
+    auto addr = new_state->memory.resolve(ptr);
+    auto pointed_obj = new_state->memory.peek_object(addr);
     assert(pointed_obj && "Pointed object must exist");
 
     auto load_value = pointed_obj->read(addr.offset);
@@ -1249,14 +1437,12 @@ AInstructionLoad::execute(state_ptr state) {
 
 bool
 AInstructionLoad::is_invariant(loop_state_ptr state, llvm::Loop* loop, llvm::Value* ptr) const {
-    auto addr = parse_ptr(state->memory.get_object(ptr), state);
-    auto pointed_obj = state->memory.get_object(addr);
+    auto pointed_obj = state->memory.peek_object(state->memory.resolve(ptr));
     for (auto bb : loop->blocks()) {
         for (auto &inst : *bb) {
             if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
                 auto stored_ptr = store_inst->getPointerOperand();
-                auto stored_addr = parse_ptr(state->memory.get_object(stored_ptr), state);
-                if (pointed_obj == state->memory.get_object(stored_addr)) {
+                if (pointed_obj == state->memory.peek_object(state->memory.resolve(stored_ptr))) {
                     return false;
                 }
             }
@@ -1273,14 +1459,11 @@ AInstructionStore::execute(state_ptr state) {
     // auto ptr_value = state->evaluate(ptr);
     state_ptr new_state = std::make_shared<State>(*state);
 
-    auto pointer_obj = new_state->memory.get_object(ptr);
-
-    auto offset = pointer_obj->get_ptr_value().offset;
-
-    auto pointed_obj = new_state->memory.get_object_pointed_by(ptr);
-    auto value_expr = state->evaluate(value, pointed_obj->is_signed());
+    auto addr = new_state->memory.resolve(ptr);
+    auto pointed_obj = new_state->memory.get_object(addr);
     assert(pointed_obj && "Pointed object must exist");
-    pointed_obj->write(offset, value_expr);
+    auto value_expr = state->evaluate(value, pointed_obj->is_signed());
+    pointed_obj->write(addr.offset, value_expr);
 
     new_state->step_pc();
     return {new_state};
@@ -1292,7 +1475,7 @@ AInstructionGEP::execute(state_ptr state) {
     assert(gep);
     auto new_state = std::make_shared<State>(*state);
     auto addr = parse_gep(gep, new_state);
-    auto target_obj = new_state->memory.get_object(addr);
+    auto target_obj = new_state->memory.peek_object(addr);
     if (target_obj->get_sizes().size() < addr.offset.size()) {
         addr.offset = std::vector<Expression>(addr.offset.begin() + 1, addr.offset.end());
     }
@@ -1311,13 +1494,13 @@ AInstructionDebug::execute(state_ptr state) {
         assert(llvm_value->getType()->isPointerTy() && "Expected a pointer type for debug declare");
         if (auto* diType = var->getType()) {
             if (diType->getName().contains("unsigned char")) {
-                auto addr = parse_ptr(state->memory.get_object(llvm_value), state);
+                auto addr = state->memory.resolve(llvm_value);
                 auto pointed_obj = state->memory.get_object(addr);
                 pointed_obj->set_signed(true);
                 state->append_path_condition(pointed_obj->get_value() >= state->z3ctx.int_val(0));
                 state->append_path_condition(pointed_obj->get_value() <= state->z3ctx.int_val(255));
             } else if (diType->getName().contains("unsigned")) {
-                auto addr = parse_ptr(state->memory.get_object(llvm_value), state);
+                auto addr = state->memory.resolve(llvm_value);
                 auto pointed_obj = state->memory.get_object(addr);
                 pointed_obj->set_signed(false);
                 state->append_path_condition(pointed_obj->get_value() >= state->z3ctx.int_val(0));
@@ -1326,16 +1509,7 @@ AInstructionDebug::execute(state_ptr state) {
     } else if (auto dbg_value = llvm::dyn_cast_or_null<llvm::DbgValueInst>(inst)) {
         auto* llvm_value = dbg_value->getValue();
         if (llvm_value->getType()->isPointerTy()) {
-            auto obj = state->memory.get_object_pointed_by(llvm_value);
-            auto var = dbg_value->getVariable();
-            auto base_size = var->getType()->getSizeInBits();
-            if (base_size == 64) {
-                auto ori_size = obj->get_sizes();
-                for (auto& size : ori_size) {
-                    size = size / size.ctx().int_val(2);
-                }
-                obj->set_sizes(ori_size);
-            }
+            // sizes of pointed objects are derived from their element types when they are allocated
         } else if (!llvm::isa<llvm::Constant>(llvm_value)) {
             if (auto* diType = dbg_value->getVariable()->getType()) {
                 auto obj = state->memory.get_object(llvm_value);
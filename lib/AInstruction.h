@@ -9,6 +9,7 @@
 //-----------------------------------------------------------------------------------------//
 
 #include <set>
+#include <unordered_map>
 
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
@@ -21,6 +22,7 @@
 #include "LoopSummary.h"
 #include "FunctionSummarizer.h"
 #include "LoopSummarizer.h"
+#include "LoopInduction.h"
 
 namespace ari_exe {
     // class State;
@@ -48,13 +50,21 @@ namespace ari_exe {
             // Get the basic block where the instruction is located
             llvm::BasicBlock* get_block();
 
-            // Factory method to create an AInstruction from an LLVM instruction
+            // Factory method to create an AInstruction from an LLVM instruction.
+            // All instructions of its function are created at once.
             static AInstruction* create(llvm::Instruction* inst);
 
             // cache all instructions
-            static std::map<llvm::Instruction*, AInstruction*> cached_instructions;
+            static std::unordered_map<llvm::Instruction*, AInstruction*> cached_instructions;
 
             llvm::Instruction* inst;
+
+        private:
+            // the next instruction in the same basic block, linked when the function is created
+            AInstruction* next = nullptr;
+
+            // create the AInstruction of the given type for an LLVM instruction, nullptr if the type is not supported
+            static AInstruction* create_one(llvm::Instruction* inst);
     };
 
     class AInstructionBinary: public AInstruction {
@@ -103,8 +113,6 @@ namespace ari_exe {
             state_ptr execute_cache(state_ptr state);
             state_ptr execute_reach_error(state_ptr state);
 
-            static std::map<llvm::Value*, int> value_counter;
-
     };
 
     class AInstructionBranch: public AInstruction {
@@ -116,6 +124,13 @@ namespace ari_exe {
 
             template<typename state_ty>
             state_list_base<state_ty> _execute(std::shared_ptr<state_ty> state);
+
+        private:
+            /**
+             * @brief record in the forked states that stay in a loop failed to be summarized that
+             *        the loop exit at block forked on a symbolic condition, see AInstructionPhi::execute
+             */
+            static void count_symbolic_exit(llvm::BasicBlock* block, const state_list& forked_states);
     };
 
     class AInstructionReturn: public AInstruction {
@@ -14,8 +14,6 @@ AnalysisManager* AnalysisManager::instance = new AnalysisManager();
 
 // z3::context AnalysisManager::z3ctx;
 
-int AnalysisManager::unknown_counter = 0;
-
 namespace {
 std::string diagnostic_to_string(const llvm::SMDiagnostic& diagnostic) {
     std::string message;
@@ -45,6 +43,51 @@ std::string clang_debug_flag() {
                  mode);
     return "-g";
 }
+
+// self tail recursion is turned into loops unless ARITHEXE_TAIL_RECURSION_TO_LOOP is off
+bool tail_recursion_to_loop_enabled() {
+    return env_flag("ARITHEXE_TAIL_RECURSION_TO_LOOP", true);
+}
+
+// whether the function calls itself directly
+bool calls_itself(const llvm::Function& F) {
+    for (auto& block : F) {
+        for (auto& inst : block) {
+            auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+            if (call && call->getCalledFunction() == &F) return true;
+        }
+    }
+    return false;
+}
+
+// TailCallElimPass whose result is kept only if no call of the function to itself is left,
+// e.g., mult(n, m) returning -mult(n, -m) keeps its recursion, since FunctionSummarizer
+// only summarizes loop free functions and LoopSummarizer does not unfold calls
+struct CompleteTailCallElimPass: llvm::PassInfoMixin<CompleteTailCallElimPass> {
+    llvm::PreservedAnalyses run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM) {
+        if (!calls_itself(F)) return llvm::PreservedAnalyses::all();
+
+        // a copy of the body outside of the module, which is restored if a self call is left
+        auto backup = llvm::Function::Create(F.getFunctionType(), F.getLinkage(), F.getAddressSpace(), F.getName());
+        llvm::ValueToValueMapTy VMap;
+        for (auto [arg, backup_arg] : llvm::zip(F.args(), backup->args())) VMap[&arg] = &backup_arg;
+        llvm::SmallVector<llvm::ReturnInst*, 4> returns;
+        llvm::CloneFunctionInto(backup, &F, VMap, llvm::CloneFunctionChangeType::LocalChangesOnly, returns);
+
+        auto preserved = llvm::TailCallElimPass().run(F, FAM);
+        if (!calls_itself(F)) {
+            delete backup;
+            return preserved;
+        }
+
+        for (auto& block : F) block.dropAllReferences();
+        while (!F.empty()) F.begin()->eraseFromParent();
+        F.splice(F.end(), backup);
+        for (auto [arg, backup_arg] : llvm::zip(F.args(), backup->args())) backup_arg.replaceAllUsesWith(&arg);
+        delete backup;
+        return llvm::PreservedAnalyses::none();
+    }
+};
 }
 
 std::unique_ptr<llvm::Module>
@@ -72,13 +115,18 @@ AnalysisManager::get_module(const std::string& c_filename, z3::context& z3ctx) {
 
     llvm::CGSCCPassManager CGPM;
     CGPM.addPass(llvm::ArgumentPromotionPass());
-    // MPM.addPass(createModuleToFunctionPassAdaptor(llvm::TailCallElimPass()));
     MPM.addPass(llvm::createModuleToPostOrderCGSCCPassAdaptor(std::move(CGPM)));
 
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::LowerSwitchPass()));
     // MPM.addPass(createModuleToFunctionPassAdaptor(llvm::PromotePass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::RegToMemPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::SROAPass(llvm::SROAOptions::ModifyCFG)));
+    // after SROA, so that the recursive calls are followed by the returns rather than by stores,
+    // and before LoopSimplify, so that the loops of the eliminated calls are normalized with the others.
+    // Such functions are then summarized by LoopSummarizer instead of unfolding frames in RecExecution.
+    if (tail_recursion_to_loop_enabled()) {
+        MPM.addPass(createModuleToFunctionPassAdaptor(CompleteTailCallElimPass()));
+    }
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::LoopSimplifyPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::LCSSAPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::SimplifyCFGPass()));
@@ -92,7 +140,6 @@ AnalysisManager::get_module(const std::string& c_filename, z3::context& z3ctx) {
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::InstructionNamerPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::AggressiveInstCombinePass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(llvm::LowerSwitchPass()));
-    // MPM.addPass(createModuleToFunctionPassAdaptor(llvm::TailCallElimPass()));
     // MPM.addPass(createModuleToFunctionPassAdaptor(llvm::PromotePass()));
     // MPM.addPass(createModuleToFunctionPassAdaptor(RegToMemPass()));
     // MPM.addPass(createModuleToFunctionPassAdaptor(MemorySSAPrinterPass(output_fd, true)));
@@ -117,6 +164,8 @@ AnalysisManager::get_module(const std::string& c_filename, z3::context& z3ctx) {
     }
 
     CG = &MAM.getResult<llvm::CallGraphAnalysis>(*mod);
+    // the values of the previous module are freed and their addresses may be reused
+    names.forget_values();
     std::string ir_str;
     llvm::raw_string_ostream rso(ir_str);
     mod->print(rso, nullptr);
@@ -2,6 +2,7 @@
 #define ANALYSISMANAGER_H
 
 #include "z3++.h"
+#include "NameService.h"
 
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/IR/LLVMContext.h"
@@ -113,13 +114,15 @@ namespace ari_exe {
             z3::expr get_ind_var() { return ind_var; }
             z3::expr get_loop_N() { return loop_N; }
 
-            // counter for unknowns
-            static int unknown_counter;
-
             static z3::context& get_ctx() { return z3ctx; }
 
+            /**
+             * @brief the naming service of z3 symbols in the analysis context
+             */
+            static NameService& get_names() { return instance->names; }
+
         private :
-            AnalysisManager(): ind_var(z3ctx.int_const("ari_loop_n")), loop_N(z3ctx.int_const("ari_loop_N")) {}
+            AnalysisManager(): ind_var(z3ctx.int_const("ari_loop_n")), loop_N(z3ctx.int_const("ari_loop_N")), names(z3ctx) {}
             static AnalysisManager* instance;
 
             // LLVM context for keeping the module
@@ -149,6 +152,9 @@ namespace ari_exe {
             // The symbolic variable for the loop iteration count
             z3::expr loop_N;
 
+            // names of the symbols in z3ctx
+            NameService names;
+
     };
 }
 
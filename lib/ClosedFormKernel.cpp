@@ -0,0 +1,440 @@
+#include "ClosedFormKernel.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+using namespace ari_exe;
+
+// larger exponents are left to z3
+static constexpr int64_t MAX_EXPONENT = 1 << 16;
+
+// larger programs are left to z3, shared subterms are duplicated in the program
+static constexpr size_t MAX_PROGRAM_SIZE = 1 << 16;
+
+BigInt::BigInt(int64_t value) {
+    negative = value < 0;
+    uint64_t magnitude = negative ? static_cast<uint64_t>(-(value + 1)) + 1 : static_cast<uint64_t>(value);
+    while (magnitude != 0) {
+        limbs.push_back(static_cast<uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+std::optional<BigInt>
+BigInt::from_string(const std::string& decimal) {
+    size_t pos = 0;
+    bool is_negative = false;
+    if (pos < decimal.size() && decimal[pos] == '-') {
+        is_negative = true;
+        pos++;
+    }
+    if (pos == decimal.size()) return std::nullopt;
+    BigInt res;
+    while (pos < decimal.size()) {
+        // consume up to 9 digits at once
+        uint32_t chunk = 0;
+        uint32_t scale = 1;
+        for (int i = 0; i < 9 && pos < decimal.size(); i++, pos++) {
+            char c = decimal[pos];
+            if (c < '0' || c > '9') return std::nullopt;
+            chunk = chunk * 10 + (c - '0');
+            scale *= 10;
+        }
+        uint64_t carry = chunk;
+        for (auto& limb : res.limbs) {
+            uint64_t cur = static_cast<uint64_t>(limb) * scale + carry;
+            limb = static_cast<uint32_t>(cur);
+            carry = cur >> 32;
+        }
+        if (carry != 0) res.limbs.push_back(static_cast<uint32_t>(carry));
+    }
+    res.trim();
+    res.negative = is_negative && !res.is_zero();
+    return res;
+}
+
+std::string
+BigInt::to_string() const {
+    if (is_zero()) return "0";
+    std::vector<uint32_t> chunks;
+    BigInt cur = *this;
+    cur.negative = false;
+    while (!cur.is_zero()) {
+        auto [quotient, remainder] = cur.divmod(1000000000);
+        chunks.push_back(static_cast<uint32_t>(remainder));
+        cur = quotient;
+    }
+    std::string res = negative ? "-" : "";
+    res += std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        auto chunk = std::to_string(chunks[i]);
+        res += std::string(9 - chunk.size(), '0') + chunk;
+    }
+    return res;
+}
+
+std::optional<uint64_t>
+BigInt::abs_to_uint64() const {
+    if (limbs.size() > 2) return std::nullopt;
+    uint64_t magnitude = 0;
+    for (size_t i = limbs.size(); i-- > 0;) magnitude = (magnitude << 32) | limbs[i];
+    return magnitude;
+}
+
+std::optional<int64_t>
+BigInt::to_int64() const {
+    auto magnitude = abs_to_uint64();
+    if (!magnitude.has_value()) return std::nullopt;
+    constexpr uint64_t max = std::numeric_limits<int64_t>::max();
+    if (!negative) {
+        if (*magnitude > max) return std::nullopt;
+        return static_cast<int64_t>(*magnitude);
+    }
+    if (*magnitude > max + 1) return std::nullopt;
+    return static_cast<int64_t>(~(*magnitude - 1));
+}
+
+std::pair<BigInt, uint64_t>
+BigInt::divmod(uint64_t divisor) const {
+    BigInt quotient;
+    quotient.limbs.resize(limbs.size());
+    unsigned __int128 remainder = 0;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        unsigned __int128 cur = (remainder << 32) | limbs[i];
+        quotient.limbs[i] = static_cast<uint32_t>(cur / divisor);
+        remainder = cur % divisor;
+    }
+    quotient.trim();
+    auto rem = static_cast<uint64_t>(remainder);
+    if (!negative) return {quotient, rem};
+    // -|a| = -q * d - r = (-q - 1) * d + (d - r)
+    quotient.negative = !quotient.is_zero();
+    if (rem == 0) return {quotient, 0};
+    return {quotient - BigInt(1), divisor - rem};
+}
+
+BigInt
+BigInt::operator-() const {
+    BigInt res = *this;
+    res.negative = !negative && !is_zero();
+    return res;
+}
+
+BigInt
+BigInt::operator+(const BigInt& other) const {
+    BigInt res;
+    if (negative == other.negative) {
+        res.limbs = add_magnitude(limbs, other.limbs);
+        res.negative = negative;
+    } else if (compare_magnitude(limbs, other.limbs) >= 0) {
+        res.limbs = sub_magnitude(limbs, other.limbs);
+        res.negative = negative;
+    } else {
+        res.limbs = sub_magnitude(other.limbs, limbs);
+        res.negative = other.negative;
+    }
+    res.trim();
+    return res;
+}
+
+BigInt
+BigInt::operator-(const BigInt& other) const {
+    return *this + (-other);
+}
+
+BigInt
+BigInt::operator*(const BigInt& other) const {
+    BigInt res;
+    if (is_zero() || other.is_zero()) return res;
+    res.limbs.assign(limbs.size() + other.limbs.size(), 0);
+    for (size_t i = 0; i < limbs.size(); i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < other.limbs.size(); j++) {
+            uint64_t cur = static_cast<uint64_t>(limbs[i]) * other.limbs[j] + res.limbs[i + j] + carry;
+            res.limbs[i + j] = static_cast<uint32_t>(cur);
+            carry = cur >> 32;
+        }
+        res.limbs[i + other.limbs.size()] = static_cast<uint32_t>(carry);
+    }
+    res.negative = negative != other.negative;
+    res.trim();
+    return res;
+}
+
+bool
+BigInt::operator<(const BigInt& other) const {
+    if (negative != other.negative) return negative;
+    int cmp = compare_magnitude(limbs, other.limbs);
+    return negative ? cmp > 0 : cmp < 0;
+}
+
+int
+BigInt::compare_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+    if (lhs.size() != rhs.size()) return lhs.size() < rhs.size() ? -1 : 1;
+    for (size_t i = lhs.size(); i-- > 0;) {
+        if (lhs[i] != rhs[i]) return lhs[i] < rhs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+std::vector<uint32_t>
+BigInt::add_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+    std::vector<uint32_t> res;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < std::max(lhs.size(), rhs.size()); i++) {
+        uint64_t cur = carry;
+        if (i < lhs.size()) cur += lhs[i];
+        if (i < rhs.size()) cur += rhs[i];
+        res.push_back(static_cast<uint32_t>(cur));
+        carry = cur >> 32;
+    }
+    if (carry != 0) res.push_back(static_cast<uint32_t>(carry));
+    return res;
+}
+
+std::vector<uint32_t>
+BigInt::sub_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+    std::vector<uint32_t> res;
+    int64_t borrow = 0;
+    for (size_t i = 0; i < lhs.size(); i++) {
+        int64_t cur = static_cast<int64_t>(lhs[i]) - borrow - (i < rhs.size() ? rhs[i] : 0);
+        borrow = cur < 0 ? 1 : 0;
+        res.push_back(static_cast<uint32_t>(cur + (borrow << 32)));
+    }
+    return res;
+}
+
+void
+BigInt::trim() {
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    if (limbs.empty()) negative = false;
+}
+
+Rational::Rational(const BigInt& num, const BigInt& den): num(num), den(den) {
+    if (den.is_negative()) {
+        this->num = -num;
+        this->den = -den;
+    }
+    reduce();
+}
+
+std::optional<Rational>
+Rational::from_numeral(const z3::expr& e) {
+    if (!e.is_numeral()) return std::nullopt;
+    std::string numeral = Z3_get_numeral_string(e.ctx(), e);
+    auto slash = numeral.find('/');
+    if (slash == std::string::npos) {
+        auto num = BigInt::from_string(numeral);
+        if (!num.has_value()) return std::nullopt;
+        return Rational(*num);
+    }
+    auto num = BigInt::from_string(numeral.substr(0, slash));
+    auto den = BigInt::from_string(numeral.substr(slash + 1));
+    if (!num.has_value() || !den.has_value() || den->is_zero()) return std::nullopt;
+    return Rational(*num, *den);
+}
+
+z3::expr
+Rational::to_expr(z3::context& ctx, bool is_int) const {
+    if (is_int) return ctx.int_val(num.to_string().c_str());
+    return ctx.real_val(to_string().c_str());
+}
+
+std::string
+Rational::to_string() const {
+    if (is_integer()) return num.to_string();
+    return num.to_string() + "/" + den.to_string();
+}
+
+Rational
+Rational::operator+(const Rational& other) const {
+    if (den == other.den) return Rational(num + other.num, den);
+    return Rational(num * other.den + other.num * den, den * other.den);
+}
+
+Rational
+Rational::operator-(const Rational& other) const {
+    return *this + (-other);
+}
+
+Rational
+Rational::operator*(const Rational& other) const {
+    return Rational(num * other.num, den * other.den);
+}
+
+std::optional<Rational>
+Rational::divide(const Rational& other) const {
+    if (other.num.is_zero()) return std::nullopt;
+    return Rational(num * other.den, den * other.num);
+}
+
+std::optional<BigInt>
+Rational::floor() const {
+    auto d = den.abs_to_uint64();
+    if (!d.has_value()) return std::nullopt;
+    return num.divmod(*d).first;
+}
+
+void
+Rational::reduce() {
+    if (num.is_zero()) {
+        den = BigInt(1);
+        return;
+    }
+    // big denominators come from big exponentials, which are kept unreduced
+    auto d = den.abs_to_uint64();
+    if (!d.has_value() || *d == 1) return;
+    auto g = std::gcd(num.divmod(*d).second, *d);
+    if (g <= 1) return;
+    num = num.divmod(g).first;
+    den = den.divmod(g).first;
+}
+
+std::optional<ClosedFormKernel>
+ClosedFormKernel::compile(const z3::expr& e, const z3::expr_vector& variables) {
+    ClosedFormKernel kernel;
+    if (!kernel.compile_expr(e, variables)) return std::nullopt;
+    return kernel;
+}
+
+bool
+ClosedFormKernel::compile_expr(const z3::expr& e, const z3::expr_vector& variables) {
+    if (program.size() > MAX_PROGRAM_SIZE) return false;
+    if (e.is_numeral()) {
+        auto value = Rational::from_numeral(e);
+        if (!value.has_value()) return false;
+        constants.push_back(*value);
+        program.push_back({CONST, static_cast<unsigned>(constants.size() - 1)});
+        return true;
+    }
+    if (!e.is_app()) return false;
+    auto kind = e.decl().decl_kind();
+    if (kind == Z3_OP_UNINTERPRETED) {
+        if (e.num_args() != 0) return false;
+        for (unsigned i = 0; i < variables.size(); i++) {
+            if (!z3::eq(e, variables[i])) continue;
+            if (!uses(i)) used_variables.push_back(i);
+            program.push_back({VAR, i});
+            return true;
+        }
+        return false;
+    }
+
+    OpCode code;
+    switch (kind) {
+        case Z3_OP_ADD: code = ADD; break;
+        case Z3_OP_SUB: code = SUB; break;
+        case Z3_OP_MUL: code = MUL; break;
+        case Z3_OP_UMINUS: code = NEG; break;
+        case Z3_OP_DIV: code = DIV; break;
+        case Z3_OP_IDIV: code = IDIV; break;
+        case Z3_OP_MOD: code = MOD; break;
+        case Z3_OP_POWER: code = POW; break;
+        case Z3_OP_TO_INT: code = TO_INT; break;
+        case Z3_OP_TO_REAL:
+            // rationals need no conversion
+            return compile_expr(e.arg(0), variables);
+        default:
+            return false;
+    }
+    for (unsigned i = 0; i < e.num_args(); i++) {
+        if (!compile_expr(e.arg(i), variables)) return false;
+    }
+    program.push_back({code, e.num_args()});
+    return true;
+}
+
+bool
+ClosedFormKernel::uses(unsigned variable) const {
+    return std::find(used_variables.begin(), used_variables.end(), variable) != used_variables.end();
+}
+
+// the exponent of a power, which must be a small natural number
+static std::optional<int64_t>
+get_exponent(const Rational& exponent) {
+    if (!exponent.is_integer()) return std::nullopt;
+    auto value = exponent.get_num().to_int64();
+    if (!value.has_value() || *value < 0 || *value > MAX_EXPONENT) return std::nullopt;
+    return value;
+}
+
+std::optional<Rational>
+ClosedFormKernel::evaluate(const std::vector<std::optional<Rational>>& values) const {
+    std::vector<Rational> stack;
+    for (auto& op : program) {
+        switch (op.code) {
+            case CONST:
+                stack.push_back(constants[op.arg]);
+                continue;
+            case VAR:
+                if (op.arg >= values.size() || !values[op.arg].has_value()) return std::nullopt;
+                stack.push_back(*values[op.arg]);
+                continue;
+            case NEG:
+                stack.back() = -stack.back();
+                continue;
+            case TO_INT: {
+                auto floor = stack.back().floor();
+                if (!floor.has_value()) return std::nullopt;
+                stack.back() = Rational(*floor);
+                continue;
+            }
+            default:
+                break;
+        }
+
+        // n-ary operations
+        auto first = stack.end() - op.arg;
+        Rational res = *first;
+        for (auto it = first + 1; it != stack.end(); ++it) {
+            auto& operand = *it;
+            switch (op.code) {
+                case ADD: res = res + operand; break;
+                case SUB: res = res - operand; break;
+                case MUL: res = res * operand; break;
+                case DIV: {
+                    auto quotient = res.divide(operand);
+                    if (!quotient.has_value()) return std::nullopt;
+                    res = *quotient;
+                    break;
+                }
+                case IDIV:
+                case MOD: {
+                    // a = b * q + r with 0 <= r < |b|
+                    if (!res.is_integer() || !operand.is_integer()) return std::nullopt;
+                    auto divisor = operand.get_num().abs_to_uint64();
+                    if (!divisor.has_value() || *divisor == 0) return std::nullopt;
+                    auto [quotient, remainder] = res.get_num().divmod(*divisor);
+                    if (op.code == MOD) {
+                        if (remainder > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) return std::nullopt;
+                        res = Rational(BigInt(static_cast<int64_t>(remainder)));
+                    } else {
+                        res = Rational(operand.get_num().is_negative() ? -quotient : quotient);
+                    }
+                    break;
+                }
+                case POW: {
+                    auto exponent = get_exponent(operand);
+                    if (!exponent.has_value()) return std::nullopt;
+                    // 0^0 is not defined in z3
+                    if (*exponent == 0 && res.get_num().is_zero()) return std::nullopt;
+                    Rational power(BigInt(1));
+                    Rational base = res;
+                    for (int64_t e = *exponent; e > 0; e >>= 1) {
+                        if (e & 1) power = power * base;
+                        if (e > 1) base = base * base;
+                    }
+                    res = power;
+                    break;
+                }
+                default:
+                    return std::nullopt;
+            }
+        }
+        stack.erase(first, stack.end());
+        stack.push_back(res);
+    }
+    if (stack.size() != 1) return std::nullopt;
+    return stack.back();
+}
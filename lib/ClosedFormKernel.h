@@ -0,0 +1,187 @@
+//--------------------------- ClosedFormKernel.h ---------------------------
+//
+// This file contains a numeric evaluator of closed-form solutions, which
+// computes their values at concrete arguments without building z3 terms.
+//
+//-------------------------------------------------------------------------
+
+#ifndef CLOSEDFORMKERNEL_H
+#define CLOSEDFORMKERNEL_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "z3++.h"
+
+namespace ari_exe {
+    /**
+     * @brief An arbitrary precision integer, with the few operations closed forms need.
+     */
+    class BigInt {
+        public:
+            BigInt() = default;
+            BigInt(int64_t value);
+
+            /**
+             * @brief parse a decimal integer, e.g., a z3 numeral
+             */
+            static std::optional<BigInt> from_string(const std::string& decimal);
+
+            std::string to_string() const;
+
+            bool is_zero() const { return limbs.empty(); }
+
+            bool is_negative() const { return negative; }
+
+            std::optional<int64_t> to_int64() const;
+
+            std::optional<uint64_t> abs_to_uint64() const;
+
+            /**
+             * @brief the floor division by a positive divisor
+             * @return the quotient and the remainder, which is in [0, divisor)
+             */
+            std::pair<BigInt, uint64_t> divmod(uint64_t divisor) const;
+
+            BigInt operator-() const;
+            BigInt operator+(const BigInt& other) const;
+            BigInt operator-(const BigInt& other) const;
+            BigInt operator*(const BigInt& other) const;
+            bool operator==(const BigInt& other) const { return negative == other.negative && limbs == other.limbs; }
+            bool operator!=(const BigInt& other) const { return !(*this == other); }
+            bool operator<(const BigInt& other) const;
+
+        private:
+            static int compare_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
+
+            static std::vector<uint32_t> add_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
+
+            // requires lhs >= rhs
+            static std::vector<uint32_t> sub_magnitude(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs);
+
+            void trim();
+
+            // magnitude in base 2^32, the least significant limb first, without leading zeros
+            std::vector<uint32_t> limbs;
+
+            // zero is never negative
+            bool negative = false;
+    };
+
+    /**
+     * @brief A rational number of big integers, reduced whenever the denominator fits in 64 bits.
+     */
+    class Rational {
+        public:
+            Rational(): num(0), den(1) {}
+            Rational(const BigInt& num): num(num), den(1) {}
+
+            /**
+             * @brief den must not be zero
+             */
+            Rational(const BigInt& num, const BigInt& den);
+
+            /**
+             * @brief parse a z3 numeral, e.g., 3, -3 or 3/4
+             */
+            static std::optional<Rational> from_numeral(const z3::expr& e);
+
+            const BigInt& get_num() const { return num; }
+
+            const BigInt& get_den() const { return den; }
+
+            bool is_integer() const { return den == BigInt(1); }
+
+            /**
+             * @brief the z3 numeral of this value, of the given sort
+             */
+            z3::expr to_expr(z3::context& ctx, bool is_int) const;
+
+            std::string to_string() const;
+
+            Rational operator-() const { return Rational(-num, den); }
+            Rational operator+(const Rational& other) const;
+            Rational operator-(const Rational& other) const;
+            Rational operator*(const Rational& other) const;
+
+            /**
+             * @brief nullopt for the division by zero
+             */
+            std::optional<Rational> divide(const Rational& other) const;
+
+            /**
+             * @brief the largest integer not greater than this value,
+             *        nullopt if the denominator is too large
+             */
+            std::optional<BigInt> floor() const;
+
+        private:
+            void reduce();
+
+            BigInt num;
+
+            // always positive
+            BigInt den;
+    };
+
+    /**
+     * @brief A closed form compiled to a postfix program over rationals.
+     * @details Closed forms are polynomials and exponentials of the loop variables, the initial
+     *          values and the iteration, i.e., numerals, constants, +, -, *, /, div, mod, ^,
+     *          to_real and to_int. Evaluating the program at concrete values is exact and does not
+     *          touch the z3 context, which is much faster than substituting and simplifying the term.
+     */
+    class ClosedFormKernel {
+        public:
+            /**
+             * @brief compile e, whose constants must be among variables
+             * @return nullopt if e is not a closed form the kernel supports
+             */
+            static std::optional<ClosedFormKernel> compile(const z3::expr& e, const z3::expr_vector& variables);
+
+            /**
+             * @brief evaluate the closed form, values are given in the order of the variables,
+             *        and only the used variables need values
+             * @return nullopt if a used value is missing, or the value is not defined, e.g., division by zero
+             */
+            std::optional<Rational> evaluate(const std::vector<std::optional<Rational>>& values) const;
+
+            /**
+             * @brief if the variable of the given index is used by the closed form
+             */
+            bool uses(unsigned variable) const;
+
+        private:
+            enum OpCode {
+                CONST,      // push constants[arg]
+                VAR,        // push values[arg]
+                ADD,        // pop arg operands and push their sum
+                SUB,        // pop arg operands and push the first minus the others
+                MUL,        // pop arg operands and push their product
+                NEG,
+                DIV,        // rational division
+                IDIV,       // integer division, as in SMT-LIB
+                MOD,        // integer remainder, as in SMT-LIB
+                POW,        // the exponent must be a small natural number
+                TO_INT,     // floor
+            };
+
+            struct Op {
+                OpCode code;
+                unsigned arg;
+            };
+
+            bool compile_expr(const z3::expr& e, const z3::expr_vector& variables);
+
+            std::vector<Op> program;
+
+            std::vector<Rational> constants;
+
+            std::vector<unsigned> used_variables;
+    };
+}
+
+#endif
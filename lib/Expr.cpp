@@ -1,7 +1,79 @@
 #include "Expr.h"
 
+#include <cstdint>
+#include <optional>
+
 namespace ari_exe {
+    /**
+     * @brief get the value of an integer numeral that fits in 64 bits
+     */
+    static std::optional<int64_t>
+    get_int_numeral(const z3::expr& e) {
+        int64_t value;
+        if (e.is_int() && e.is_numeral() && e.is_numeral_i64(value)) {
+            return value;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief build op(lhs, rhs), folding it eagerly when both sides are integer numerals
+     * @param fold computes the result on numerals, nullopt if it cannot be folded
+     *        (e.g., overflow or division by zero)
+     */
+    static z3::expr
+    fold_int_op(const z3::expr& lhs, const z3::expr& rhs,
+                const std::function<std::optional<int64_t>(int64_t, int64_t)>& fold,
+                const std::function<z3::expr(const z3::expr&, const z3::expr&)>& build) {
+        auto lhs_value = get_int_numeral(lhs);
+        auto rhs_value = get_int_numeral(rhs);
+        if (lhs_value && rhs_value) {
+            if (auto res = fold(*lhs_value, *rhs_value)) {
+                return lhs.ctx().int_val(*res);
+            }
+        }
+        return build(lhs, rhs);
+    }
+
+    /**
+     * @brief build cmp(lhs, rhs), folding it eagerly when both sides are integer numerals
+     */
+    static z3::expr
+    fold_int_cmp(const z3::expr& lhs, const z3::expr& rhs,
+                 const std::function<bool(int64_t, int64_t)>& cmp,
+                 const std::function<z3::expr(const z3::expr&, const z3::expr&)>& build) {
+        auto lhs_value = get_int_numeral(lhs);
+        auto rhs_value = get_int_numeral(rhs);
+        if (lhs_value && rhs_value) {
+            return lhs.ctx().bool_val(cmp(*lhs_value, *rhs_value));
+        }
+        return build(lhs, rhs);
+    }
+
+    // integer division and remainder of z3, i.e., the remainder is always non-negative
+    static std::optional<int64_t>
+    euclidean_div(int64_t a, int64_t b) {
+        if (b == 0 || (a == INT64_MIN && b == -1)) return std::nullopt;
+        int64_t q = a / b;
+        if (a % b < 0) q = b > 0 ? q - 1 : q + 1;
+        return q;
+    }
+
+    static std::optional<int64_t>
+    euclidean_mod(int64_t a, int64_t b) {
+        if (b == 0 || (a == INT64_MIN && b == -1)) return std::nullopt;
+        int64_t r = a % b;
+        if (r < 0) r += b > 0 ? b : -b;
+        return r;
+    }
+
     Expression::Expression(const z3::expr& expr) : conditions(expr.ctx()), expressions(expr.ctx()) {
+        if (expr.is_const()) {
+            // nothing to unfold, skip expr2piecewise
+            conditions.push_back(expr.ctx().bool_val(true));
+            expressions.push_back(expr);
+            return;
+        }
         auto [_conditions, _expressions] = expr2piecewise(expr);
         conditions = _conditions;
         expressions = _expressions;
@@ -17,55 +89,97 @@ namespace ari_exe {
     }
 
     Expression Expression::operator+(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs + rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_op(lhs, rhs, [](int64_t a, int64_t b) -> std::optional<int64_t> {
+                int64_t res;
+                if (__builtin_add_overflow(a, b, &res)) return std::nullopt;
+                return res;
+            }, [](const z3::expr& l, const z3::expr& r) { return l + r; });
+        });
     }
 
     Expression Expression::operator-(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs - rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_op(lhs, rhs, [](int64_t a, int64_t b) -> std::optional<int64_t> {
+                int64_t res;
+                if (__builtin_sub_overflow(a, b, &res)) return std::nullopt;
+                return res;
+            }, [](const z3::expr& l, const z3::expr& r) { return l - r; });
+        });
     }
 
     Expression Expression::operator*(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs * rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_op(lhs, rhs, [](int64_t a, int64_t b) -> std::optional<int64_t> {
+                int64_t res;
+                if (__builtin_mul_overflow(a, b, &res)) return std::nullopt;
+                return res;
+            }, [](const z3::expr& l, const z3::expr& r) { return l * r; });
+        });
     }
 
     Expression Expression::operator/(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return (lhs / rhs).simplify(); });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_op(lhs, rhs, euclidean_div, [](const z3::expr& l, const z3::expr& r) { return (l / r).simplify(); });
+        });
     }
 
     Expression Expression::operator%(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs % rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_op(lhs, rhs, euclidean_mod, [](const z3::expr& l, const z3::expr& r) { return l % r; });
+        });
     }
 
     Expression Expression::operator==(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs == rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::equal_to<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l == r; });
+        });
     }
 
     Expression Expression::operator!=(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs != rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::not_equal_to<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l != r; });
+        });
     }
 
     Expression Expression::operator<(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs < rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::less<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l < r; });
+        });
     }
 
     Expression Expression::operator<=(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs <= rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::less_equal<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l <= r; });
+        });
     }
 
     Expression Expression::operator>(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs > rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::greater<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l > r; });
+        });
     }
 
     Expression Expression::operator>=(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs >= rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            return fold_int_cmp(lhs, rhs, std::greater_equal<int64_t>(), [](const z3::expr& l, const z3::expr& r) { return l >= r; });
+        });
     }
 
     Expression Expression::operator&&(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs && rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            if (lhs.is_false() || rhs.is_true()) return lhs;
+            if (lhs.is_true() || rhs.is_false()) return rhs;
+            return lhs && rhs;
+        });
     }
 
     Expression Expression::operator||(const Expression& other) const {
-        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) { return lhs || rhs; });
+        return bin_operator(*this, other, [](const z3::expr& lhs, const z3::expr& rhs) {
+            if (lhs.is_true() || rhs.is_false()) return lhs;
+            if (lhs.is_false() || rhs.is_true()) return rhs;
+            return lhs || rhs;
+        });
     }
 
     Expression Expression::operator^(const Expression& other) const {
@@ -75,8 +189,12 @@ namespace ari_exe {
     Expression Expression::operator!() const {
         z3::expr_vector new_expressions(ctx());
         for (const auto& expr : expressions) {
-            if (expr.is_bool()) {
+            if (expr.is_true() || expr.is_false()) {
+                new_expressions.push_back(ctx().bool_val(expr.is_false()));
+            } else if (expr.is_bool()) {
                 new_expressions.push_back(!expr);
+            } else if (auto value = get_int_numeral(expr)) {
+                new_expressions.push_back(ctx().bool_val(*value == 0));
             } else {
                 new_expressions.push_back(expr == 0);
             }
@@ -87,7 +205,12 @@ namespace ari_exe {
     Expression Expression::operator-() const {
         z3::expr_vector new_expressions(ctx());
         for (const auto& expr : expressions) {
-            new_expressions.push_back(-expr);
+            auto value = get_int_numeral(expr);
+            if (value && *value != INT64_MIN) {
+                new_expressions.push_back(ctx().int_val(-*value));
+            } else {
+                new_expressions.push_back(-expr);
+            }
         }
         return Expression(conditions, new_expressions);
     }
@@ -96,6 +219,39 @@ namespace ari_exe {
         return *this;
     }
 
+    std::optional<bool>
+    Expression::get_concrete_truth() const {
+        std::optional<bool> res;
+        for (const auto& expr : expressions) {
+            std::optional<bool> cur;
+            if (expr.is_true() || expr.is_false()) {
+                cur = expr.is_true();
+            } else if (expr.is_int() && expr.is_numeral()) {
+                auto value = get_int_numeral(expr);
+                // numerals beyond 64 bits are non-zero
+                cur = !value.has_value() || *value != 0;
+            }
+            if (!cur.has_value() || (res.has_value() && *res != *cur)) {
+                return std::nullopt;
+            }
+            res = cur;
+        }
+        return res;
+    }
+
+    std::optional<int64_t>
+    Expression::get_concrete_int() const {
+        std::optional<int64_t> res;
+        for (const auto& expr : expressions) {
+            auto cur = get_int_numeral(expr);
+            if (!cur.has_value() || (res.has_value() && *res != *cur)) {
+                return std::nullopt;
+            }
+            res = cur;
+        }
+        return res;
+    }
+
     z3::expr Expression::as_expr() const {
         auto res = piecewise2ite(conditions, expressions);
         return res;
@@ -109,8 +265,10 @@ namespace ari_exe {
         for (const auto& indices : cartesian_product(sizes)) {
             auto lhs_cond = lhs.conditions[indices[0]];
             auto rhs_cond = rhs.conditions[indices[1]];
-            auto cur_cond = lhs_cond && rhs_cond;
-            if (!is_feasible(cur_cond)) continue;
+            // avoid building trivial conjunctions and querying the solver for them
+            auto cur_cond = lhs_cond.is_true() ? rhs_cond : (rhs_cond.is_true() ? lhs_cond : lhs_cond && rhs_cond);
+            if (cur_cond.is_false()) continue;
+            if (!cur_cond.is_true() && !is_feasible(cur_cond)) continue;
             new_conditions.push_back(cur_cond);
             new_expressions.push_back(op(lhs.expressions[indices[0]], rhs.expressions[indices[1]]));
         }
@@ -7,6 +7,7 @@
 #include "AnalysisManager.h"
 
 #include <functional>
+#include <optional>
 
 namespace ari_exe {
     /**
@@ -50,6 +51,18 @@ namespace ari_exe {
             z3::expr_vector get_expressions() const { return expressions; }
             z3::context& ctx() const { return conditions.ctx(); }
 
+            /**
+             * @brief the truth value of this expression if it does not depend on
+             *        symbolic values, where integers are true iff they are non-zero
+             */
+            std::optional<bool> get_concrete_truth() const;
+
+            /**
+             * @brief the integer value of this expression if it does not depend on
+             *        symbolic values, i.e., all pieces are the same numeral fitting in 64 bits
+             */
+            std::optional<int64_t> get_concrete_int() const;
+
             void push_front(z3::expr condition, z3::expr expr);
 
             Expression subs(const z3::expr_vector& src, const std::vector<Expression>& dst) const;
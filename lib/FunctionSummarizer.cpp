@@ -1,6 +1,9 @@
 #include "FunctionSummarizer.h"
 #include <spdlog/spdlog.h>
 
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+
 using namespace ari_exe;
 
 RecExecution::RecExecution(z3::context& z3ctx, llvm::Function* F): z3ctx(z3ctx), F(F), solver(z3ctx) {
@@ -216,15 +219,14 @@ FunctionSummarizer::summarize_pointers() {
     z3::expr_vector dst(z3ctx);
     for (auto& arg : F->args()) {
         assert(arg.getType()->isPointerTy() && "Expected pointer type for function argument");
-        auto obj = initial_state->memory.get_object_pointed_by(&arg);
-        auto name = get_z3_name(arg.getName().str());
-        auto func = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
+        auto obj = initial_state->memory.peek_object_pointed_by(&arg);
+        auto func = AnalysisManager::get_names().int_function(&arg);
         // initial_values.insert_or_assign(func(z3ctx.int_val(0)), obj->get_value().as_expr());
         initial_lhs.push_back(func(z3ctx.int_val(0)));
         initial_rhs.push_back(obj->get_value().as_expr());
         
-        src.push_back(z3ctx.int_const(name.c_str()));
-        params.push_back(z3ctx.int_const(name.c_str()));
+        src.push_back(AnalysisManager::get_names().int_const(&arg));
+        params.push_back(AnalysisManager::get_names().int_const(&arg));
         dst.push_back(func(manager->get_ind_var()));
     }
 
@@ -236,9 +238,8 @@ FunctionSummarizer::summarize_pointers() {
         conditions.push_back(path_cond.substitute(src, dst).simplify());
         rec_ty rec_eq;
         for (auto& arg : F->args()) {
-            auto obj = state->memory.get_object_pointed_by(&arg);
-            auto name = get_z3_name(arg.getName().str());
-            auto func = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
+            auto obj = state->memory.peek_object_pointed_by(&arg);
+            auto func = AnalysisManager::get_names().int_function(&arg);
             auto obj_value = obj->get_value().as_expr();
             auto value = obj_value.substitute(src, dst);
             if (value.to_string().find("_unknown_") != std::string::npos) {
@@ -521,4 +522,40 @@ FunctionSummarizer::get_last_meaningful_inst(const trace_ty& trace) {
         return *it;
     }
     return nullptr;
-}
\ No newline at end of file
+}
+
+void
+FunctionSummarizer::summarize_bottom_up(llvm::Function* entry, z3::context& z3ctx) {
+    auto CG = AnalysisManager::get_instance()->get_CG();
+    auto cache = Cache::get_instance();
+
+    std::set<llvm::Function*> reachable;
+    std::vector<llvm::CallGraphNode*> worklist{(*CG)[entry]};
+    while (!worklist.empty()) {
+        auto node = worklist.back();
+        worklist.pop_back();
+        auto func = node->getFunction();
+        if (func == nullptr || !reachable.insert(func).second) continue;
+        for (auto& call_record : *node) worklist.push_back(call_record.second);
+    }
+
+    // SCCs are visited in post order, i.e., callees before callers
+    for (auto scc = llvm::scc_begin(CG); !scc.isAtEnd(); ++scc) {
+        if (!scc.hasCycle()) continue;
+        for (auto node : *scc) {
+            auto func = node->getFunction();
+            if (func == nullptr || !func->hasExactDefinition() || !reachable.count(func)) continue;
+            if (cache->is_visited(func) || State::func_summaries->get_value(func).has_value()) continue;
+            // FunctionSummarizer only summarizes loop free functions, others are executed without summaries
+            if (!AnalysisManager::get_instance()->get_LI(func).empty()) continue;
+            spdlog::info("Summarizing recursive function {}", func->getName().str());
+            // failures are caught by the summarizer, so the function is not summarized again at its call sites
+            FunctionSummarizer summarizer(func, z3ctx);
+            auto summary = summarizer.get_summary();
+            cache->mark_visited(func);
+            if (summary.has_value()) {
+                State::func_summaries->insert_or_assign(func, *summary);
+            }
+        }
+    }
+}
@@ -84,6 +84,14 @@ namespace ari_exe {
             // get the function application in z3 based on the function signature
             z3::expr function_app_z3(llvm::Function* f);
 
+            /**
+             * @brief summarize the recursive functions reachable from entry ahead of the execution,
+             *        visiting the SCCs of the call graph bottom-up, so that the summaries of callees
+             *        are in State::func_summaries when their callers are summarized.
+             *        Functions with loops are skipped, they are executed without summaries.
+             */
+            static void summarize_bottom_up(llvm::Function* entry, z3::context& z3ctx);
+
         private:
             llvm::Function* F;
             z3::context& z3ctx;
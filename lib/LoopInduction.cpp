@@ -0,0 +1,231 @@
+#include <spdlog/spdlog.h>
+#include "LoopInduction.h"
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace ari_exe {
+    using budget_clock = std::chrono::steady_clock;
+
+    static budget_clock::time_point budget_start = budget_clock::now();
+
+    // the block calls reach_error, so exiting the loop to it is an error
+    static bool
+    calls_reach_error(llvm::BasicBlock* block) {
+        for (auto& inst : *block) {
+            auto call_inst = llvm::dyn_cast<llvm::CallInst>(&inst);
+            auto func = call_inst ? call_inst->getCalledFunction() : nullptr;
+            if (func && (func->getName().contains("reach_error") || func->getName() == "__VERIFIER_error")) return true;
+        }
+        return false;
+    }
+
+    // encode the value of an integer phi, booleans are 0 or 1
+    static std::optional<z3::expr>
+    as_int(const Expression& value) {
+        auto e = value.as_expr();
+        if (e.is_bool()) return z3::ite(e, e.ctx().int_val(1), e.ctx().int_val(0));
+        if (!e.is_int()) return std::nullopt;
+        return e;
+    }
+
+    LoopInduction::LoopInduction(llvm::Loop* loop, state_ptr parent_state)
+        : loop(loop), parent_state(parent_state), z3ctx(parent_state->z3ctx),
+          suffix("_induction_" + std::to_string(AnalysisManager::get_names().next_id(loop))),
+          variables(parent_state->z3ctx), entry_values(parent_state->z3ctx), obligation(parent_state->z3ctx.bool_val(true)) {}
+
+    void
+    LoopInduction::start_budget() {
+        budget_start = budget_clock::now();
+    }
+
+    unsigned
+    LoopInduction::get_unroll_depth() {
+        static const unsigned depth = env_size("ARITHEXE_UNROLL_DEPTH", 8);
+        static const unsigned budget = env_size("ARITHEXE_TIME_BUDGET", 0);
+        if (budget == 0) return depth;
+        double elapsed = std::chrono::duration<double>(budget_clock::now() - budget_start).count();
+        double left = std::max(0.0, 1.0 - elapsed / budget);
+        // at least one iteration is unrolled, so that the assertions in it are checked exactly
+        return std::max(1u, static_cast<unsigned>(depth * left));
+    }
+
+    unsigned
+    LoopInduction::get_induction_depth() {
+        static const unsigned depth = env_size("ARITHEXE_KINDUCTION_DEPTH", 4);
+        return depth;
+    }
+
+    bool
+    LoopInduction::is_supported(llvm::Loop* loop) {
+        if (!loop->getSubLoops().empty()) return false;
+        auto latch = loop->getLoopLatch();
+        // the exits at the latch are taken after the final states of LoopExecution
+        if (latch == nullptr || loop->isLoopExiting(latch)) return false;
+        for (auto& phi : loop->getHeader()->phis()) {
+            if (!phi.getType()->isIntegerTy()) return false;
+        }
+        for (auto block : loop->blocks()) {
+            for (auto& inst : *block) {
+                if (llvm::isa<llvm::StoreInst>(&inst)) return false;
+                auto call_inst = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (call_inst == nullptr || llvm::isa<llvm::DbgInfoIntrinsic>(call_inst)) continue;
+                auto func = call_inst->getCalledFunction();
+                if (func == nullptr) continue;
+                auto name = func->getName();
+                if (name.contains("reach_error") || name == "__VERIFIER_error" || name.contains("malloc")) return false;
+                if (func->isIntrinsic() && call_inst->mayWriteToMemory()) return false;
+                if (func->hasExactDefinition() && !name.ends_with("assert") && !name.contains("assume")) return false;
+            }
+        }
+        return true;
+    }
+
+    bool
+    LoopInduction::encode() {
+        auto header = loop->getHeader();
+        auto latch = loop->getLoopLatch();
+        auto entry_block = parent_state->trace.back();
+        auto& names = AnalysisManager::get_names();
+        for (auto& phi : header->phis()) {
+            variables.push_back(z3ctx.int_const((names.z3_name(&phi) + suffix).c_str()));
+            auto entry_value = as_int(parent_state->evaluate(phi.getIncomingValueForBlock(entry_block)));
+            if (!entry_value.has_value()) return false;
+            entry_values.push_back(*entry_value);
+        }
+        // the counters of unknown calls start from unknown values, which tell the calls of this loop apart
+        std::vector<llvm::CallInst*> unknown_calls;
+        for (auto block : loop->blocks()) {
+            for (auto& inst : *block) {
+                auto call_inst = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (call_inst == nullptr) continue;
+                auto func = call_inst->getCalledFunction();
+                if (func && func->hasExactDefinition()) continue;
+                unknown_calls.push_back(call_inst);
+                variables.push_back(z3ctx.int_const((names.z3_name(call_inst) + "_call_count" + suffix).c_str()));
+            }
+        }
+
+        auto execution = LoopExecution(loop, parent_state, suffix);
+        auto [final_states, loop_exit_states] = execution.run();
+        for (auto& state : final_states) {
+            if (state->status == State::TERMINATED) return false;
+            z3::expr_vector updates(z3ctx);
+            for (auto& phi : header->phis()) {
+                auto update = as_int(state->evaluate(phi.getIncomingValueForBlock(latch)));
+                if (!update.has_value()) return false;
+                updates.push_back(*update);
+            }
+            for (size_t i = 0; i < unknown_calls.size(); i++) {
+                auto it = state->unknown_call_counters.find(unknown_calls[i]);
+                auto counter = variables[entry_values.size() + i];
+                updates.push_back(it != state->unknown_call_counters.end() ? it->second : counter + 1);
+            }
+            transitions.emplace_back(state->get_path_condition().as_expr(), updates);
+        }
+
+        z3::expr_vector conjuncts(z3ctx);
+        auto v_conditions = execution.get_v_conditions();
+        auto v_path_conditions = execution.get_v_path_conditions();
+        for (size_t i = 0; i < v_conditions.size(); i++) {
+            conjuncts.push_back(z3::implies(v_path_conditions[i].as_expr(), v_conditions[i].as_expr()));
+        }
+        for (auto& state : loop_exit_states) {
+            if (calls_reach_error(state->pc->get_block())) {
+                conjuncts.push_back(!state->get_path_condition().as_expr());
+            } else {
+                exit_states.push_back(state);
+            }
+        }
+        obligation = z3::mk_and(conjuncts);
+        return true;
+    }
+
+    z3::expr
+    LoopInduction::at_iteration(const z3::expr& e, unsigned iteration) {
+        z3::expr_vector renamed(z3ctx);
+        for (auto variable : variables) {
+            auto name = variable.decl().name().str() + "_" + std::to_string(iteration);
+            renamed.push_back(z3ctx.int_const(name.c_str()));
+        }
+        auto res = e;
+        return res.substitute(variables, renamed);
+    }
+
+    z3::expr
+    LoopInduction::transition(unsigned iteration) {
+        z3::expr_vector paths(z3ctx);
+        for (auto& [condition, updates] : transitions) {
+            z3::expr_vector conjuncts(z3ctx);
+            conjuncts.push_back(at_iteration(condition, iteration));
+            for (unsigned i = 0; i < variables.size(); i++) {
+                conjuncts.push_back(at_iteration(variables[i], iteration + 1) == at_iteration(updates[i], iteration));
+            }
+            paths.push_back(z3::mk_and(conjuncts));
+        }
+        return z3::mk_or(paths);
+    }
+
+    z3::check_result
+    LoopInduction::check_violation(z3::solver& solver, unsigned iteration) {
+        // the literal enables the query only for this check
+        auto literal = z3ctx.bool_const(AnalysisManager::get_names().fresh_name(loop->getHeader(), "_kinduction_").c_str());
+        solver.add(z3::implies(literal, !at_iteration(obligation, iteration)));
+        z3::expr_vector assumptions(z3ctx);
+        assumptions.push_back(literal);
+        return solver.check(assumptions);
+    }
+
+    std::optional<std::vector<state_ptr>>
+    LoopInduction::run(unsigned max_k) {
+        if (max_k == 0 || !is_supported(loop) || !encode()) return std::nullopt;
+
+        auto header_name = loop->getHeader()->getName().str();
+        auto parent_condition = parent_state->get_path_condition().as_expr();
+        z3::solver base(z3ctx);
+        z3::solver step(z3ctx);
+        base.add(parent_condition);
+        step.add(parent_condition);
+        for (unsigned i = 0; i < entry_values.size(); i++) {
+            base.add(at_iteration(variables[i], 0) == entry_values[i]);
+        }
+        for (unsigned k = 0; k < max_k; k++) {
+            // base case: the k-th iteration from the entry meets the obligation
+            if (check_violation(base, k) != z3::unsat) {
+                spdlog::info("k-induction of loop {} fails in the base case at iteration {}", header_name, k);
+                return std::nullopt;
+            }
+            base.add(at_iteration(obligation, k));
+            base.add(transition(k));
+
+            // step case: k + 1 iterations meeting the obligation are followed by one meeting it
+            step.add(at_iteration(obligation, k));
+            step.add(transition(k));
+            if (check_violation(step, k + 1) == z3::unsat) {
+                spdlog::info("Proved loop {} by {}-induction", header_name, k + 1);
+                std::vector<state_ptr> states;
+                for (auto& exit_state : exit_states) {
+                    auto path_condition = parent_condition && obligation && exit_state->get_path_condition().as_expr();
+                    auto trace = parent_state->trace;
+                    trace.insert(trace.end(), exit_state->trace.begin(), exit_state->trace.end());
+                    auto state = std::make_shared<State>(z3ctx, exit_state->pc, exit_state->prev_pc, exit_state->memory, path_condition, trace, State::TESTING);
+                    state->is_over_approx = true;
+                    state->nondet_calls = parent_state->nondet_calls;
+                    state->counterexample_complete = parent_state->counterexample_complete;
+                    state->loop_certificates = parent_state->loop_certificates;
+                    state->function_certificates = parent_state->function_certificates;
+                    state->unrolled_iterations = parent_state->unrolled_iterations;
+                    state->unrolled_iterations.erase(loop);
+                    state->symbolic_exits = parent_state->symbolic_exits;
+                    state->symbolic_exits.erase(loop);
+                    states.push_back(state);
+                }
+                return states;
+            }
+        }
+        spdlog::info("k-induction of loop {} fails in the step case up to k = {}", header_name, max_k);
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,119 @@
+//--------------------------- LoopInduction.h ---------------------------
+//
+// This file contains the LoopInduction class, which proves the assertions
+// of loops that cannot be summarized by k-induction, and the bound on
+// the unrolling of these loops.
+//
+//-------------------------------------------------------------------------
+
+#ifndef LOOPINDUCTION_H
+#define LOOPINDUCTION_H
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/Analysis/LoopInfo.h"
+
+#include "z3++.h"
+
+#include "state.h"
+#include "LoopSummarizer.h"
+
+namespace ari_exe {
+    /**
+     * @brief k-induction over the header phis of a loop that cannot be summarized.
+     * @details The loop body is executed once by LoopExecution from symbolic header phis,
+     *          which gives the transition of one iteration and the obligations of an iteration,
+     *          i.e., its assertions hold and it does not exit to a block calling reach_error.
+     *          The base case checks the obligations of the first k iterations from the parent state,
+     *          and the step case checks that k consecutive iterations meeting the obligations
+     *          are followed by one that meets them too. Both cases grow one iteration at a time
+     *          in their own incremental solver.
+     */
+    class LoopInduction {
+        public:
+            LoopInduction(llvm::Loop* loop, state_ptr parent_state);
+
+            /**
+             * @brief prove the obligations of the loop by k-induction for k up to max_k
+             * @return the states at the exits of the loop, whose header phis are unknown but meet
+             *         the obligations, or nullopt if the loop is not supported or the proof fails
+             */
+            std::optional<std::vector<state_ptr>> run(unsigned max_k);
+
+            /**
+             * @brief loops with a single latch, integer header phis, no nested loops, no stores
+             *        and no calls to defined functions other than assertions and assumptions
+             */
+            static bool is_supported(llvm::Loop* loop);
+
+            /**
+             * @brief the number of iterations of a loop that cannot be summarized unrolled on a path
+             *        before proving the rest of the loop by k-induction, ARITHEXE_UNROLL_DEPTH, 8 by default.
+             *        Only iterations whose exit branch forked on a symbolic condition are counted.
+             *        If ARITHEXE_TIME_BUDGET gives a budget in seconds, the depth shrinks with the budget left,
+             *        down to 1.
+             */
+            static unsigned get_unroll_depth();
+
+            /**
+             * @brief the largest k tried by k-induction, ARITHEXE_KINDUCTION_DEPTH, 4 by default
+             */
+            static unsigned get_induction_depth();
+
+            /**
+             * @brief start spending the time budget, called when the verification starts
+             */
+            static void start_budget();
+
+        private:
+            /**
+             * @brief execute the loop body and build the transitions and the obligation
+             * @return false if the loop body cannot be encoded
+             */
+            bool encode();
+
+            /**
+             * @brief rename the variables in e to their copies at the given iteration
+             */
+            z3::expr at_iteration(const z3::expr& e, unsigned iteration);
+
+            /**
+             * @brief the transition from the given iteration to the next one
+             */
+            z3::expr transition(unsigned iteration);
+
+            /**
+             * @brief check if the obligation may be violated at the given iteration
+             */
+            z3::check_result check_violation(z3::solver& solver, unsigned iteration);
+
+            llvm::Loop* loop;
+
+            state_ptr parent_state;
+
+            z3::context& z3ctx;
+
+            // appended to the names of the symbols of this execution of the loop
+            std::string suffix;
+
+            // the header phis and the counters of unknown calls
+            z3::expr_vector variables;
+
+            // the values of the header phis when entering the loop
+            z3::expr_vector entry_values;
+
+            // the path condition and the updates of the variables of each path through the body
+            std::vector<std::pair<z3::expr, z3::expr_vector>> transitions;
+
+            // holds at every iteration meeting the assertions and not reaching an error
+            z3::expr obligation;
+
+            // the states arriving at the other exit blocks
+            loop_state_list exit_states;
+    };
+}
+
+#endif
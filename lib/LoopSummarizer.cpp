@@ -3,28 +3,245 @@
 
 
 namespace ari_exe {
-    static MemoryAddress_ty
-    parse_ptr(const MemoryObjectPtr ptr, state_ptr state) {
-        assert(ptr->is_pointer() && "Pointer object expected");
-        auto pointed_addr = ptr->get_ptr_value();
-        auto pointed_obj = state->memory.get_object(pointed_addr);
-        if (!pointed_obj->is_pointer()) {
-            return pointed_addr;
-        }
-        auto addr = parse_ptr(pointed_obj, state);
-        for (auto& offset : pointed_addr.offset) {
-            addr.offset.push_back(offset);
+    /**
+     * @brief states of a loop body are merged at join points unless ARITHEXE_LOOP_STATE_MERGING is off
+     */
+    static bool
+    state_merging_enabled() {
+        static bool enabled = env_flag("ARITHEXE_LOOP_STATE_MERGING", true);
+        return enabled;
+    }
+
+    // collect the conjuncts of e in order, dropping true
+    static void
+    collect_conjuncts(const z3::expr& e, std::vector<z3::expr>& conjuncts) {
+        if (e.is_and()) {
+            for (unsigned i = 0; i < e.num_args(); i++) collect_conjuncts(e.arg(i), conjuncts);
+        } else if (!e.is_true()) {
+            conjuncts.push_back(e);
         }
-        return addr;
     }
+
     LoopExecution::~LoopExecution() {
         assert(states.empty());
+        assert(merging_states.empty());
     }
 
-    LoopExecution::LoopExecution(llvm::Loop *loop, state_ptr parent_state): loop(loop), solver(AnalysisManager::get_instance()->get_z3ctx()), parent_state(parent_state), v_conditions() {
+    LoopExecution::LoopExecution(llvm::Loop *loop, state_ptr parent_state, const std::string& symbol_suffix): loop(loop), solver(AnalysisManager::get_instance()->get_z3ctx()), parent_state(parent_state), v_conditions(), symbol_suffix(symbol_suffix) {
         auto initial_state = build_initial_state();
         states.push(initial_state);
         stores = get_all_stores(loop);
+        if (state_merging_enabled()) compute_merge_points();
+    }
+
+    void
+    LoopExecution::compute_merge_points() {
+        auto header = loop->getHeader();
+        auto& LI = AnalysisManager::get_instance()->get_LI(header->getParent());
+        llvm::LoopBlocksRPO rpo(loop);
+        rpo.perform(&LI);
+        size_t position = 0;
+        for (auto block : rpo) {
+            position++;
+            if (block == header || LI.getLoopFor(block) != loop) continue;
+            size_t num_preds = 0;
+            for (auto pred : llvm::predecessors(block)) {
+                if (loop->contains(pred)) num_preds++;
+            }
+            if (num_preds < 2) continue;
+            merge_points.insert_or_assign(&*block->getFirstNonPHIOrDbg(), position);
+        }
+    }
+
+    void
+    LoopExecution::add_state(loop_state_ptr state) {
+        auto it = merge_points.find(state->pc->inst);
+        if (it == merge_points.end() || state->status != State::RUNNING) {
+            states.push(state);
+            return;
+        }
+        auto& waiting = merging_states[it->second];
+        for (auto& other : waiting) {
+            if (!same_records(*other, *state)) continue;
+            // at most one merge is tried per state, so that a join point costs linearly many solver checks
+            if (auto merged = merge(other, state)) {
+                other = merged;
+                return;
+            }
+            break;
+        }
+        waiting.push_back(state);
+    }
+
+    void
+    LoopExecution::release_merged_states() {
+        auto first = merging_states.begin();
+        for (auto& state : first->second) states.push(state);
+        merging_states.erase(first);
+    }
+
+    // split the conjuncts of lhs and rhs into the shared ones and the ones only in lhs or rhs
+    static std::tuple<z3::expr_vector, z3::expr_vector, z3::expr_vector>
+    split_conjuncts(const z3::expr& lhs, const z3::expr& rhs) {
+        std::vector<z3::expr> lhs_conjuncts;
+        std::vector<z3::expr> rhs_conjuncts;
+        collect_conjuncts(lhs, lhs_conjuncts);
+        collect_conjuncts(rhs, rhs_conjuncts);
+        std::set<unsigned> lhs_ids;
+        std::set<unsigned> rhs_ids;
+        for (auto& c : lhs_conjuncts) lhs_ids.insert(c.id());
+        for (auto& c : rhs_conjuncts) rhs_ids.insert(c.id());
+
+        z3::expr_vector common(lhs.ctx());
+        z3::expr_vector lhs_only(lhs.ctx());
+        z3::expr_vector rhs_only(lhs.ctx());
+        for (auto& c : lhs_conjuncts) {
+            if (rhs_ids.count(c.id())) common.push_back(c);
+            else lhs_only.push_back(c);
+        }
+        for (auto& c : rhs_conjuncts) {
+            if (!lhs_ids.count(c.id())) rhs_only.push_back(c);
+        }
+        return {common, lhs_only, rhs_only};
+    }
+
+    // the disjunction of two paths sharing the conjuncts in common
+    static z3::expr
+    join_paths(const z3::expr_vector& common, const z3::expr_vector& lhs_only, const z3::expr_vector& rhs_only) {
+        auto either = (z3::mk_and(lhs_only) || z3::mk_and(rhs_only)).simplify();
+        if (either.is_true()) return z3::mk_and(common);
+        return z3::mk_and(common) && either;
+    }
+
+    static bool
+    same_optional_expr(const std::optional<z3::expr>& lhs, const std::optional<z3::expr>& rhs) {
+        if (lhs.has_value() != rhs.has_value()) return false;
+        return !lhs.has_value() || z3::eq(*lhs, *rhs);
+    }
+
+    // the same unknown calls recorded with the same values in the same order
+    static bool
+    same_nondet_calls(const std::vector<NondetCall>& lhs, const std::vector<NondetCall>& rhs) {
+        if (lhs.size() != rhs.size()) return false;
+        for (size_t i = 0; i < lhs.size(); i++) {
+            auto& l = lhs[i];
+            auto& r = rhs[i];
+            if (l.instruction != r.instruction) return false;
+            if (!same_optional_expr(l.value, r.value) || !same_optional_expr(l.count, r.count)) return false;
+            if (l.values.has_value() != r.values.has_value()) return false;
+            if (l.values.has_value() && l.values->id() != r.values->id()) return false;
+        }
+        return true;
+    }
+
+    static bool
+    same_variables(const std::vector<ClosedFormVariable>& lhs, const std::vector<ClosedFormVariable>& rhs) {
+        if (lhs.size() != rhs.size()) return false;
+        for (size_t i = 0; i < lhs.size(); i++) {
+            if (lhs[i].value != rhs[i].value || !z3::eq(lhs[i].expression, rhs[i].expression)) return false;
+        }
+        return true;
+    }
+
+    static bool
+    same_loop_certificates(const std::vector<LoopCertificate>& lhs, const std::vector<LoopCertificate>& rhs) {
+        if (lhs.size() != rhs.size()) return false;
+        for (size_t i = 0; i < lhs.size(); i++) {
+            if (lhs[i].loop != rhs[i].loop || !same_variables(lhs[i].variables, rhs[i].variables)) return false;
+        }
+        return true;
+    }
+
+    static bool
+    same_function_certificates(const std::vector<FunctionCertificate>& lhs, const std::vector<FunctionCertificate>& rhs) {
+        if (lhs.size() != rhs.size()) return false;
+        for (size_t i = 0; i < lhs.size(); i++) {
+            auto& l = lhs[i];
+            auto& r = rhs[i];
+            if (l.function != r.function || !z3::eq(l.result, r.result) || l.parameters.size() != r.parameters.size()) return false;
+            for (size_t j = 0; j < l.parameters.size(); j++) {
+                if (!z3::eq(l.parameters[j].symbol, r.parameters[j].symbol)) return false;
+            }
+        }
+        return true;
+    }
+
+    // the longest prefix shared by the traces, i.e., the blocks visited before the paths diverge
+    static trace_ty
+    common_trace(const trace_ty& lhs, const trace_ty& rhs) {
+        auto [lhs_end, rhs_end] = std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+        return trace_ty(lhs.begin(), lhs_end);
+    }
+
+    bool
+    LoopExecution::same_records(const LoopState& lhs, const LoopState& rhs) {
+        return same_nondet_calls(lhs.nondet_calls, rhs.nondet_calls) &&
+               same_loop_certificates(lhs.loop_certificates, rhs.loop_certificates) &&
+               same_function_certificates(lhs.function_certificates, rhs.function_certificates) &&
+               lhs.unknown_call_counters.size() == rhs.unknown_call_counters.size() &&
+               z3::eq(lhs.verification_condition.as_expr(), rhs.verification_condition.as_expr());
+    }
+
+    // some conjunct of lhs is the negation of a conjunct of rhs, e.g., the paths took different sides of a branch
+    static bool
+    has_complementary_conjuncts(const z3::expr_vector& lhs, const z3::expr_vector& rhs) {
+        std::set<unsigned> ids;
+        std::set<unsigned> negated_ids;
+        for (const auto& c : lhs) {
+            ids.insert(c.id());
+            if (c.is_not()) negated_ids.insert(c.arg(0).id());
+        }
+        for (const auto& c : rhs) {
+            if (negated_ids.count(c.id())) return true;
+            if (c.is_not() && ids.count(c.arg(0).id())) return true;
+        }
+        return false;
+    }
+
+    loop_state_ptr
+    LoopExecution::merge(loop_state_ptr lhs, loop_state_ptr rhs) {
+        if (lhs->pc != rhs->pc || lhs->status != State::RUNNING || rhs->status != State::RUNNING) return nullptr;
+        // the records are not guarded by path conditions, so they must be the same on both paths
+        if (!same_records(*lhs, *rhs)) return nullptr;
+
+        // the conjuncts that are not shared by the paths in the loop body tell them apart
+        auto [common, lhs_only, rhs_only] = split_conjuncts(lhs->path_condition_in_loop.as_expr(), rhs->path_condition_in_loop.as_expr());
+        if (lhs_only.empty() || rhs_only.empty()) return nullptr;
+        auto cond = z3::mk_and(lhs_only);
+
+        // ite(cond, lhs, rhs) picks the values of rhs only if cond never holds on rhs,
+        // which is known without the solver for the two sides of a branch
+        if (!has_complementary_conjuncts(lhs_only, rhs_only)) {
+            SolverPool::Lease lease(lhs->z3ctx);
+            auto& solver = *lease;
+            solver.add(z3::mk_and(common));
+            solver.add(z3::mk_and(rhs_only));
+            solver.add(cond);
+            if (solver.check() != z3::unsat) return nullptr;
+        }
+
+        auto memory = Memory(lhs->memory);
+        if (!memory.merge(rhs->memory, cond)) return nullptr;
+
+        auto [pc_common, pc_lhs_only, pc_rhs_only] = split_conjuncts(lhs->get_path_condition().as_expr(), rhs->get_path_condition().as_expr());
+        auto path_condition = join_paths(pc_common, pc_lhs_only, pc_rhs_only);
+        auto path_condition_in_loop = join_paths(common, lhs_only, rhs_only);
+        // the blocks after the paths diverge differ, and the terminator of the merge block extends the trace again
+        auto trace = common_trace(lhs->trace, rhs->trace);
+        auto merged = std::make_shared<LoopState>(lhs->z3ctx, lhs->pc, lhs->prev_pc, memory, path_condition, path_condition_in_loop, trace, State::RUNNING);
+        merged->summarizing_loop = lhs->summarizing_loop;
+        for (auto& [call_inst, counter] : lhs->unknown_call_counters) {
+            auto it = rhs->unknown_call_counters.find(call_inst);
+            if (it == rhs->unknown_call_counters.end()) return nullptr;
+            merged->unknown_call_counters.insert_or_assign(call_inst, z3::eq(counter, it->second) ? counter : z3::ite(cond, counter, it->second));
+        }
+        merged->verification_condition = lhs->verification_condition;
+        merged->is_over_approx = lhs->is_over_approx || rhs->is_over_approx;
+        merged->counterexample_complete = lhs->counterexample_complete && rhs->counterexample_complete;
+        merged->nondet_calls = lhs->nondet_calls;
+        merged->loop_certificates = lhs->loop_certificates;
+        merged->function_certificates = lhs->function_certificates;
+        return merged;
     }
 
     std::vector<llvm::StoreInst*>
@@ -102,7 +319,7 @@ namespace ari_exe {
         put_header_phis_in_initial_state(initial_state);
         symbolize_stores(initial_state);
         for (auto call_inst : get_unknown_calls(loop)) {
-            auto name = get_z3_name(call_inst->getName().str()) + "_call_count";
+            auto name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count" + symbol_suffix;
             initial_state->unknown_call_counters.insert_or_assign(call_inst, z3ctx.int_const(name.c_str()));
         }
         return initial_state;
@@ -121,7 +338,7 @@ namespace ari_exe {
                 auto new_state = std::make_shared<LoopState>(*state);
                 auto counter_it = new_state->unknown_call_counters.find(call_inst);
                 if (counter_it == new_state->unknown_call_counters.end()) {
-                    auto counter_name = get_z3_name(call_inst->getName().str()) + "_call_count";
+                    auto counter_name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count" + symbol_suffix;
                     auto inserted = new_state->unknown_call_counters.insert_or_assign(call_inst, z3ctx.int_const(counter_name.c_str()));
                     counter_it = inserted.first;
                 }
@@ -151,8 +368,8 @@ namespace ari_exe {
                 auto ptr = load_inst->getPointerOperand();
                 auto new_state = std::make_shared<LoopState>(*state);
 
-                auto addr = parse_ptr(new_state->memory.get_object(ptr), new_state);
-                auto pointed_obj = parent_state->memory.get_object(addr);
+                auto addr = new_state->memory.resolve(ptr);
+                auto pointed_obj = parent_state->memory.peek_object(addr);
                 assert(pointed_obj && "Pointed object must exist");
 
                 auto load_value = pointed_obj->read(addr.offset);
@@ -174,10 +391,10 @@ namespace ari_exe {
         // if the value is a store instruction, get the value operand
         if (auto store_inst = dyn_cast_or_null<llvm::StoreInst>(inst)) {
             auto ptr = store_inst->getPointerOperand();
-            auto ptr_obj = state->memory.get_object(ptr);
+            auto ptr_obj = state->memory.peek_object(ptr);
             assert(ptr_obj->is_pointer());
             auto addr = ptr_obj->get_ptr_value();   
-            return state->memory.get_object(addr)->get_llvm_value();
+            return state->memory.peek_object(addr)->get_llvm_value();
         }
         return nullptr;
     }
@@ -188,12 +405,17 @@ namespace ari_exe {
         loop_state_list exit_states;
 
         spdlog::debug("Tracing loop {}", loop->getHeader()->getName().str());
-        while (!states.empty()) {
+        while (!states.empty() || !merging_states.empty()) {
+            if (states.empty()) {
+                release_merged_states();
+                continue;
+            }
             auto cur_state = states.front();
             spdlog::debug("Current state: {}", cur_state->pc->inst->getName().str());
             // llvm::errs() << *cur_state->pc->inst << "\n";
             // llvm::errs() << cur_state->memory.to_string() << "\n";
             states.pop();
+            MemoryAccounting::get_instance()->sample(*cur_state);
             if (back_edge_taken(cur_state)) {
                 continue;
             }
@@ -212,11 +434,12 @@ namespace ari_exe {
                 auto res = test(cur_state);
                 if (res == L_FEASIBLE) {
                     cur_state->status = State::RUNNING;
-                    states.push(cur_state);
+                    add_state(cur_state);
                 }
                 continue;
             } else if (cur_state->status == State::VERIFYING) {
                 v_conditions.push_back(cur_state->verification_condition);
+                v_path_conditions.push_back(cur_state->get_path_condition());
                 // cur_state->append_path_condition(cur_state->verification_condition);
                 // auto res = test(cur_state);
                 states.push(cur_state);
@@ -226,7 +449,7 @@ namespace ari_exe {
                 cur_state->status = State::RUNNING;
             }
             auto new_states = step(cur_state);
-            for (auto& new_state : new_states) states.push(new_state);
+            for (auto& new_state : new_states) add_state(new_state);
         }
         spdlog::debug("Tracing finished");
         return {final_states, exit_states};
@@ -245,6 +468,7 @@ namespace ari_exe {
 
     void
     LoopSummarizer::summarize() {
+        MemoryAccounting::Phase phase("loop " + loop->getHeader()->getName().str());
         auto [final_states, exit_states, v_conditions] = get_final_and_exit_states();
         log_states(final_states, exit_states);
 
@@ -303,17 +527,27 @@ namespace ari_exe {
         auto n = manager->get_ind_var();
         auto N = manager->get_loop_N();
         auto N_value = summary->get_N();
+
+        // all obligations share the premise, and each one is checked under its own assumption literal
+        z3::solver solver(z3ctx);
+        z3::expr premise = 0 <= n;
+        if (N_value.has_value()) premise = premise && n < *N_value;
+        // looks like there are some bugs in z3 for doing negation of forall
+        // z3::expr query =  z3::forall(n, z3::implies(premise, summary->evaluate_expr(v_condition.as_expr())));
+        // solver.add(!query);
+        solver.add(premise);
+        // the same assertion may be reached along several paths of the body
+        std::set<unsigned> checked;
         for (auto& v_condition : v_conditions) {
-            z3::solver solver(z3ctx);
-            z3::expr premise = 0 <= n;
-            if (N_value.has_value()) premise = premise && n < *N_value;
-            // looks like there are some bugs in z3 for doing negation of forall
-            // z3::expr query =  z3::forall(n, z3::implies(premise, summary->evaluate_expr(v_condition.as_expr())));
-            // solver.add(!query);
-            solver.add(premise);
-            z3::expr query = summary->evaluate_expr(v_condition.as_expr());
-            solver.add(!query);
-            auto res = solver.check();
+            auto condition = v_condition.as_expr();
+            if (!checked.insert(condition.id()).second) continue;
+            z3::expr query = summary->evaluate_expr(condition).simplify();
+            if (query.is_true()) continue;
+            auto literal = z3ctx.bool_const(AnalysisManager::get_names().fresh_name(loop->getHeader(), "_invariant_").c_str());
+            solver.add(z3::implies(literal, !query));
+            z3::expr_vector assumptions(z3ctx);
+            assumptions.push_back(literal);
+            auto res = solver.check(assumptions);
             if (res == z3::sat) {
                 return FAIL;
             } else if (res == z3::unknown) {
@@ -348,8 +582,7 @@ namespace ari_exe {
         z3::expr_vector params_values(rec_s.z3ctx);
         for (auto& phi : loop->getHeader()->phis()) {
             modified_values.push_back(&phi);
-            auto name = get_z3_name(phi.getName().str());
-            auto phi_func = rec_s.z3ctx.int_const(name.c_str());
+            auto phi_func = AnalysisManager::get_names().int_const(&phi);
             auto it = closed.find(phi_func);
             if (it != closed.end()) {
                 auto closed_form = it->second;
@@ -363,8 +596,8 @@ namespace ari_exe {
         for (auto& inst: *loop->getHeader()) {
             if (auto store_inst = llvm::dyn_cast_or_null<llvm::StoreInst>(&inst)) {
                 auto ptr = store_inst->getPointerOperand();
-                auto ptr_obj = final_states[0]->memory.get_object(ptr);
-                auto name = get_z3_name(ptr_obj->get_llvm_value()->getName().str());
+                auto ptr_obj = final_states[0]->memory.peek_object(ptr);
+                auto name = AnalysisManager::get_names().z3_name(ptr_obj->get_llvm_value());
 
                 // auto written_value = store_inst->getValueOperand();
                 // modified_values.push_back(written_value);
@@ -397,8 +630,7 @@ namespace ari_exe {
         auto loop_guard_vars = Logic().collect_vars(loop_guard);
         std::vector<z3::expr> modified_values_expr;
         for (auto& m_value : modified_values) {
-            auto name = get_z3_name(m_value->getName().str());
-            auto z3_value = rec_s.z3ctx.int_const(name.c_str());
+            auto z3_value = AnalysisManager::get_names().int_const(m_value);
             modified_values_expr.push_back(z3_value);
         }
         std::set<std::string> iteration_related_vars;
@@ -420,6 +652,11 @@ namespace ari_exe {
             N_vec.push_back(N);
             spdlog::info("Solving for N");
             auto N_value = linear_logic.solve_vars(N_constraints, N_vec);
+            if (linear_logic.is_truncated()) {
+                // the guard is too large to be solved precisely
+                spdlog::info("constraints on the number of iterations are too large, over-approximate the loop");
+                is_approximate = true;
+            }
             if (N_value.size() == 0) {
                 spdlog::info("fail to compute the number of iterations, record the constraints on it in path conditions");
                 N_constraints = z3ctx.bool_val(true);
@@ -459,7 +696,7 @@ namespace ari_exe {
     }
 
     std::pair<z3::expr, rec_ty>
-    LoopSummarizer::get_array_base_case(const MemoryObjectPtr array) {
+    LoopSummarizer::get_array_base_case(const MemoryObject* array) {
         auto manager = AnalysisManager::get_instance();
         auto& z3ctx = manager->get_z3ctx();
         auto sig = array->get_signature();
@@ -481,7 +718,7 @@ namespace ari_exe {
     }
 
     z3::func_decl
-    LoopSummarizer::get_array_rec_func(const MemoryObjectPtr array) {
+    LoopSummarizer::get_array_rec_func(const MemoryObject* array) {
         auto manager = AnalysisManager::get_instance();
         auto& z3ctx = manager->get_z3ctx();
         auto sig = array->get_signature();
@@ -498,7 +735,7 @@ namespace ari_exe {
     LoopSummarizer::get_array_recursive_case(loop_state_ptr state, llvm::Value* array_ptr) {
         auto manager = AnalysisManager::get_instance();
         auto& z3ctx = manager->get_z3ctx();
-        auto array = state->memory.get_object_pointed_by(array_ptr);
+        auto array = state->memory.peek_object_pointed_by(array_ptr);
         auto sig = array->get_signature();
         auto path_condition = state->path_condition_in_loop;
         // auto array_ptr = state->memory.get_object(array->get_llvm_value());
@@ -562,7 +799,7 @@ namespace ari_exe {
     void
     LoopSummarizer::summarize_array(const loop_state_list& final_states, const loop_state_list& exit_states) {
         spdlog::info("Summarizing arrays");
-        auto arrays = parent_state->memory.get_arrays();
+        auto arrays = parent_state->memory.peek_arrays();
         auto manager = AnalysisManager::get_instance();
         auto& z3ctx = manager->get_z3ctx();
         assert(summary.has_value() && "Loop summary for scalars should be computed before summarizing arrays");
@@ -651,7 +888,7 @@ namespace ari_exe {
     }
 
     std::pair<z3::expr, rec_ty>
-    LoopSummarizer::get_array_frame_case(std::vector<z3::expr> conditions, const MemoryObjectPtr array) {
+    LoopSummarizer::get_array_frame_case(std::vector<z3::expr> conditions, const MemoryObject* array) {
         auto manager = AnalysisManager::get_instance();
         auto& z3ctx = manager->get_z3ctx();
         auto sig = array->get_signature();
@@ -684,10 +921,10 @@ namespace ari_exe {
         for (auto& inst : *header) {
             if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
                 auto ptr = store_inst->getPointerOperand();
-                auto ptr_obj = update_state.memory.get_object(ptr);
+                auto ptr_obj = update_state.memory.peek_object(ptr);
                 assert(ptr_obj->is_pointer());
                 auto addr = ptr_obj->get_ptr_value();
-                auto m_obj = update_state.memory.get_object(addr);
+                auto m_obj = update_state.memory.peek_object(addr);
                 if (m_obj->is_array()) {
                     modified_stmts.push_back(store_inst);
                 }
@@ -710,17 +947,21 @@ namespace ari_exe {
             values.push_back(parent_state->evaluate(phi_value).as_expr().simplify());
         }
         for (auto call_inst : get_unknown_calls()) {
-            auto name = get_z3_name(call_inst->getName().str()) + "_call_count";
+            auto name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count";
             auto counter_func = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
             func.push_back(counter_func(z3ctx.int_val(0)));
             values.push_back(z3ctx.int_val(0));
         }
-        auto accessible_objects = parent_state->memory.get_accessible_objects();
-        for (auto obj : accessible_objects) {
+        std::vector<const MemoryObject*> scalars;
+        if (auto& accessed = get_accessed_scalars()) {
+            scalars = accessed.value();
+        } else {
+            scalars = parent_state->memory.peek_accessible_objects();
+        }
+        for (auto obj : scalars) {
             if (obj->is_scalar()) {
-                auto name = get_z3_name(obj->get_llvm_value()->getName().str());
                 auto z3_value = obj->read().as_expr().simplify();
-                func.push_back(z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort())(z3ctx.int_val(0)));
+                func.push_back(AnalysisManager::get_names().int_function(obj->get_llvm_value())(z3ctx.int_val(0)));
                 values.push_back(z3_value);
             }
         }
@@ -759,7 +1000,7 @@ namespace ari_exe {
         auto manager = AnalysisManager::get_instance();
         z3::context& z3ctx = manager->get_z3ctx();
         for (auto& phi : header->phis()) {
-            auto name = get_z3_name(phi.getName().str());
+            auto name = AnalysisManager::get_names().z3_name(&phi) + symbol_suffix;
             auto z3_value = z3ctx.int_const(name.c_str());
             memory.put_temp(&phi, z3_value);
         }
@@ -855,7 +1096,7 @@ namespace ari_exe {
             for (auto call_inst : unknown_calls) {
                 auto counter_it = state->unknown_call_counters.find(call_inst);
                 if (counter_it == state->unknown_call_counters.end()) {
-                    auto counter_name = get_z3_name(call_inst->getName().str()) + "_call_count";
+                    auto counter_name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count";
                     auto counter = rec_s.z3ctx.int_const(counter_name.c_str());
                     auto unknown_name = "ari_" + call_inst->getName().str() + "_unknown";
                     auto unknown_func = rec_s.z3ctx.function(unknown_name.c_str(), rec_s.z3ctx.int_sort(), rec_s.z3ctx.int_sort());
@@ -879,15 +1120,18 @@ namespace ari_exe {
             for (const auto& indices : cartesian_product(sizes)) {
                 z3::expr_vector tmp_conditions = get_elements_by_indices(ite_conditions, indices);
                 z3::expr_vector tmp_expressions = get_elements_by_indices(ite_expressions, indices);
-                path_conds.push_back(path_cond && z3::mk_and(tmp_conditions).substitute(src, dst));
+                auto case_cond = path_cond && z3::mk_and(tmp_conditions).substitute(src, dst);
+                // updates of merged states are guarded by the same conditions, drop the cases mixing contradicting ones
+                if (case_cond.simplify().is_false()) continue;
+                path_conds.push_back(case_cond);
                 rec_ty eq;
                 for (int i = 0; i < tmp_expressions.size(); i++) {
                     std::string name;
                     if (i < phis.size()) {
-                        name = get_z3_name(phis[i]->getName().str());
+                        name = AnalysisManager::get_names().z3_name(phis[i]);
                     } else {
                         auto call_inst = unknown_calls[i - phis.size()];
-                        name = get_z3_name(call_inst->getName().str()) + "_call_count";
+                        name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count";
                     }
                     auto phi_func = rec_s.z3ctx.function(name.c_str(), rec_s.z3ctx.int_sort(), rec_s.z3ctx.int_sort());
                     eq.insert_or_assign(phi_func(manager->get_ind_var() + 1), tmp_expressions[i].substitute(src, dst));
@@ -929,7 +1173,7 @@ namespace ari_exe {
         constraints = constraints && !loop_guard_closed_form.substitute(src, dst);
         constraints = constraints && N >= 0;
         spdlog::info("constraints for N: {}", constraints.to_string());
-        constraints = constraints && parent_state->get_path_condition().as_expr();
+        constraints = constraints && entry_condition.value_or(parent_state->get_path_condition().as_expr());
         constraints = constraints.substitute(params, values);
 
         z3::tactic qe_tactic = z3::tactic(z3ctx, "qe");
@@ -978,14 +1222,213 @@ namespace ari_exe {
         return phis;
     }
 
+    size_t LoopSummarizer::summarized_count = 0;
+
     std::optional<LoopSummary>
     LoopSummarizer::get_summary() {
-        if (!summary.has_value()) {
-            summarize();
+        if (summary.has_value()) return summary;
+
+        auto header = loop->getHeader();
+        auto cached = State::loop_summaries->get_value(header);
+
+        // the entry values are the key of the table, and they also slice the path condition for summarize
+        auto entry_values = get_entry_values();
+        entry_condition = get_entry_condition(entry_values);
+        entry_values.push_back(entry_condition.value());
+
+        if (cached.has_value() && cached->is_computed_for(entry_values)) {
+            spdlog::info("Reusing the summary of loop {}", header->getName().str());
+            summary = cached;
+            return summary;
+        }
+
+        summarized_count++;
+        summarize();
+        if (summary.has_value()) {
+            summary->set_entry_values(entry_values);
+            State::loop_summaries->insert_or_assign(header, summary.value());
         }
         return summary;
     }
 
+    // push the number of cases of the expression followed by its conditions and expressions
+    static void
+    push_expression_terms(const Expression& e, z3::expr_vector& values) {
+        auto conditions = e.get_conditions();
+        auto expressions = e.get_expressions();
+        values.push_back(values.ctx().int_val(static_cast<int>(conditions.size())));
+        for (const auto& c : conditions) values.push_back(c);
+        for (const auto& v : expressions) values.push_back(v);
+    }
+
+    // push the stored content of the object, or its address if it is a pointer
+    static void
+    push_object_values(const MemoryObject& obj, z3::expr_vector& values) {
+        auto& z3ctx = values.ctx();
+        if (obj.is_pointer()) {
+            auto addr = obj.get_ptr_value();
+            values.push_back(z3ctx.int_val(static_cast<int>(addr.loc)));
+            push_expression_terms(addr.base, values);
+            values.push_back(z3ctx.int_val(static_cast<int>(addr.offset.size())));
+            for (auto& offset : addr.offset) push_expression_terms(offset, values);
+        } else {
+            obj.push_stored_terms(values);
+        }
+    }
+
+    z3::expr_vector
+    LoopSummarizer::get_entry_values() {
+        auto& z3ctx = rec_s.z3ctx;
+        z3::expr_vector values(z3ctx);
+        auto prev_block = parent_state->trace.back();
+        for (auto& phi : loop->getHeader()->phis()) {
+            auto phi_value = phi.getIncomingValueForBlock(prev_block);
+            push_expression_terms(parent_state->evaluate(phi_value), values);
+        }
+
+        // values defined outside the loop are read from the parent state by the loop body
+        std::set<llvm::Value*> live_ins;
+        for (auto block : loop->blocks()) {
+            for (auto& inst : *block) {
+                for (auto& op : inst.operands()) {
+                    auto def = llvm::dyn_cast<llvm::Instruction>(op.get());
+                    if ((def && !loop->contains(def)) || llvm::isa<llvm::Argument>(op.get())) {
+                        live_ins.insert(op.get());
+                    }
+                }
+            }
+        }
+        for (auto value : live_ins) {
+            if (auto obj = parent_state->memory.peek_object(value)) push_object_values(*obj, values);
+        }
+
+        // the summary does not depend on the scalars the loop does not access,
+        // so that a nested loop is summarized once for the paths of its outer loop body
+        if (auto& accessed = get_accessed_scalars()) {
+            values.push_back(z3ctx.int_val(static_cast<int>(accessed->size())));
+            for (auto obj : accessed.value()) push_object_values(*obj, values);
+            for (auto array : parent_state->memory.peek_arrays()) push_object_values(*array, values);
+            return values;
+        }
+        auto accessible_objects = parent_state->memory.peek_accessible_objects();
+        values.push_back(z3ctx.int_val(static_cast<int>(accessible_objects.size())));
+        for (auto obj : accessible_objects) push_object_values(*obj, values);
+        return values;
+    }
+
+    const std::optional<std::vector<const MemoryObject*>>&
+    LoopSummarizer::get_accessed_scalars() {
+        if (!accessed_scalars_computed) {
+            accessed_scalars = compute_accessed_scalars();
+            accessed_scalars_computed = true;
+        }
+        return accessed_scalars;
+    }
+
+    std::optional<std::vector<const MemoryObject*>>
+    LoopSummarizer::compute_accessed_scalars() {
+        auto& memory = parent_state->memory;
+        std::vector<const MemoryObject*> accessed;
+        for (auto block : loop->blocks()) {
+            for (auto& inst : *block) {
+                if (auto call_inst = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+                    auto callee = call_inst->getCalledFunction();
+                    if (!callee) continue;
+                    // see AInstructionCall::execute, verification calls do not access memory,
+                    // and unknown calls only return symbolic values
+                    auto name = callee->getName();
+                    if (name.ends_with("assert") || name.contains("reach_error") || name == "__VERIFIER_error" ||
+                        name.contains("assume")) {
+                        continue;
+                    }
+                    if (name.contains("malloc") || name.contains("llvm.memcpy")) return std::nullopt;
+                    if (callee->hasExactDefinition() && !callee->doesNotAccessMemory()) return std::nullopt;
+                    continue;
+                }
+
+                llvm::Value* ptr = nullptr;
+                if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(&inst)) ptr = load_inst->getPointerOperand();
+                if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(&inst)) ptr = store_inst->getPointerOperand();
+                if (!ptr) continue;
+
+                while (auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(ptr)) {
+                    if (!loop->contains(gep)) break;
+                    ptr = gep->getPointerOperand();
+                }
+                // pointers computed by the loop, e.g., by phis or loads, may point to any object
+                if (auto def = llvm::dyn_cast<llvm::Instruction>(ptr); def && loop->contains(def)) return std::nullopt;
+
+                auto ptr_obj = memory.peek_object(ptr);
+                if (!ptr_obj || !ptr_obj->is_pointer()) return std::nullopt;
+                auto obj = memory.peek_object(memory.resolve(*ptr_obj));
+                if (!obj || obj->is_pointer()) return std::nullopt;
+                // arrays are summarized as a whole, see summarize_array
+                if (obj->is_scalar() && std::find(accessed.begin(), accessed.end(), obj) == accessed.end()) {
+                    accessed.push_back(obj);
+                }
+            }
+        }
+        return accessed;
+    }
+
+    // collect the names of uninterpreted symbols in e
+    static void
+    collect_symbols(const z3::expr& e, std::set<std::string>& symbols) {
+        std::set<unsigned> visited;
+        std::vector<z3::expr> todo{e};
+        while (!todo.empty()) {
+            auto cur = todo.back();
+            todo.pop_back();
+            if (!visited.insert(cur.id()).second) continue;
+            if (cur.is_app()) {
+                if (cur.decl().decl_kind() == Z3_OP_UNINTERPRETED) symbols.insert(cur.decl().name().str());
+                for (unsigned i = 0; i < cur.num_args(); i++) todo.push_back(cur.arg(i));
+            } else if (cur.is_quantifier() || cur.is_lambda()) {
+                todo.push_back(cur.body());
+            }
+        }
+    }
+
+    z3::expr
+    LoopSummarizer::get_entry_condition(const z3::expr_vector& entry_values) {
+        auto manager = AnalysisManager::get_instance();
+        auto path_condition = parent_state->get_path_condition().as_expr();
+
+        std::vector<z3::expr> conjuncts;
+        collect_conjuncts(path_condition, conjuncts);
+
+        // the loop counters are shared by all loops, so constraints on them stay related
+        std::set<std::string> related;
+        for (auto value : entry_values) collect_symbols(value, related);
+        collect_symbols(manager->get_ind_var(), related);
+        collect_symbols(manager->get_loop_N(), related);
+
+        std::vector<std::set<std::string>> conjunct_symbols(conjuncts.size());
+        for (size_t i = 0; i < conjuncts.size(); i++) collect_symbols(conjuncts[i], conjunct_symbols[i]);
+
+        std::vector<bool> taken(conjuncts.size(), false);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < conjuncts.size(); i++) {
+                if (taken[i]) continue;
+                auto& symbols = conjunct_symbols[i];
+                bool is_related = symbols.empty() || std::any_of(symbols.begin(), symbols.end(),
+                                                                 [&](const std::string& s) { return related.count(s) > 0; });
+                if (!is_related) continue;
+                taken[i] = true;
+                related.insert(symbols.begin(), symbols.end());
+                changed = true;
+            }
+        }
+
+        z3::expr_vector slice(path_condition.ctx());
+        for (size_t i = 0; i < conjuncts.size(); i++) {
+            if (taken[i]) slice.push_back(conjuncts[i]);
+        }
+        return z3::mk_and(slice).simplify();
+    }
+
     std::pair<z3::expr_vector, z3::expr_vector>
     LoopSummarizer::get_header_phis_scalar_and_func() {
         auto header = loop->getHeader();
@@ -995,14 +1438,13 @@ namespace ari_exe {
         z3::expr_vector src(z3ctx);
         z3::expr_vector dst(z3ctx);
         for(auto& phi : header->phis()) {
-            auto name = get_z3_name(phi.getName().str());
-            auto phi_src = z3ctx.int_const(name.c_str());
-            auto phi_dst = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
+            auto phi_src = AnalysisManager::get_names().int_const(&phi);
+            auto phi_dst = AnalysisManager::get_names().int_function(&phi);
             src.push_back(phi_src);
             dst.push_back(phi_dst(manager->get_ind_var()));
         }
         for (auto call_inst : get_unknown_calls()) {
-            auto name = get_z3_name(call_inst->getName().str()) + "_call_count";
+            auto name = AnalysisManager::get_names().z3_name(call_inst) + "_call_count";
             auto counter_src = z3ctx.int_const(name.c_str());
             auto counter_dst = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
             src.push_back(counter_src);
@@ -1042,9 +1484,8 @@ namespace ari_exe {
 
         auto header = loop->getHeader();
         for (auto& phi : header->phis()) {
-            auto name = get_z3_name(phi.getName().str());
-            auto z3_const = z3ctx.int_const(name.c_str());
-            auto z3_func = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
+            auto z3_const = AnalysisManager::get_names().int_const(&phi);
+            auto z3_func = AnalysisManager::get_names().int_function(&phi);
             modified_values.push_back(z3_const);
             functions.push_back(z3_func(manager->get_ind_var()));
         }
@@ -1052,9 +1493,8 @@ namespace ari_exe {
             for (auto& inst : *block) {
                 if (auto store_inst = dyn_cast_or_null<llvm::StoreInst>(&inst)) {
                     auto written_value = store_inst->getValueOperand();
-                    auto name = get_z3_name(written_value->getName().str());
-                    auto z3_const = z3ctx.int_const(name.c_str());
-                    auto z3_func = z3ctx.function(name.c_str(), z3ctx.int_sort(), z3ctx.int_sort());
+                    auto z3_const = AnalysisManager::get_names().int_const(written_value);
+                    auto z3_func = AnalysisManager::get_names().int_function(written_value);
                     modified_values.push_back(z3_const);
                     functions.push_back(z3_func(manager->get_ind_var()));
                 }
@@ -18,6 +18,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopIterator.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -47,7 +48,11 @@ namespace ari_exe {
                 L_UNFEASIBLE,
                 L_TESTUNKNOWN,
             };
-            LoopExecution(llvm::Loop* loop, state_ptr parent_state);
+            /**
+             * @param symbol_suffix appended to the names of the symbols of the header phis and
+             *        the counters of unknown calls, so that several executions of a loop do not share them
+             */
+            LoopExecution(llvm::Loop* loop, state_ptr parent_state, const std::string& symbol_suffix = "");
             ~LoopExecution();
     
             // execute one instruction
@@ -86,6 +91,13 @@ namespace ari_exe {
                 return v_conditions;
             }
 
+            /**
+             * @brief the path conditions under which the v_conditions are encountered
+             */
+            std::vector<Expression> get_v_path_conditions() const {
+                return v_path_conditions;
+            }
+
         private:
             /**
              * @brief Check if the current state is a final state, which is a state
@@ -137,12 +149,49 @@ namespace ari_exe {
              */
             void symbolize_stores(loop_state_ptr state);
 
+            /**
+             * @brief find the merge points of the loop body, which are the first non-phi instructions
+             *        of blocks with several predecessors in the loop, excluding the header and nested loops.
+             *        They are numbered in the reverse post order of the body.
+             */
+            void compute_merge_points();
+
+            /**
+             * @brief add a state to the worklist, states at merge points wait there to be merged
+             */
+            void add_state(loop_state_ptr state);
+
+            /**
+             * @brief move the states waiting at the first merge point in the reverse post order to the worklist,
+             *        which is done when no other state can reach that merge point
+             */
+            void release_merged_states();
+
+            /**
+             * @brief merge two states at the same instruction into one, whose values are
+             *        guarded by the conditions telling their paths in the loop body apart
+             * @return nullptr if the states cannot be merged
+             */
+            loop_state_ptr merge(loop_state_ptr lhs, loop_state_ptr rhs);
+
+            /**
+             * @brief check if the records of two states, which are not guarded by path conditions,
+             *        are the same, e.g., unknown calls and certificates, so that the states may be merged
+             */
+            static bool same_records(const LoopState& lhs, const LoopState& rhs);
+
             llvm::Loop* loop;
 
             z3::solver solver;
     
             std::queue<loop_state_ptr> states;
 
+            // the position of each merge point in the reverse post order of the loop body
+            std::map<llvm::Instruction*, size_t> merge_points;
+
+            // states waiting at merge points, by the positions of the merge points
+            std::map<size_t, loop_state_list> merging_states;
+
             // parent state, in which this loop execution is invoked
             state_ptr parent_state;
 
@@ -150,6 +199,11 @@ namespace ari_exe {
             // must verify them if summarization succeeds
             std::vector<Expression> v_conditions;
 
+            std::vector<Expression> v_path_conditions;
+
+            // see the constructor
+            std::string symbol_suffix;
+
             std::vector<llvm::StoreInst*> stores;
 
             std::vector<llvm::CallInst*> unknown_calls;
@@ -172,7 +226,14 @@ namespace ari_exe {
 
             std::optional<LoopSummary> get_summary();
 
+            /**
+             * @brief number of loops summarized so far, summaries reused from State::loop_summaries are not counted
+             */
+            static size_t get_summarized_count() { return summarized_count; }
+
         private:
+            static size_t summarized_count;
+
             llvm::Loop* loop;
             rec_solver rec_s;
             std::optional<LoopSummary> summary;
@@ -206,13 +267,13 @@ namespace ari_exe {
              *        Thus, this function is added another parameter to denote
              *        the loop counter.
              */
-            z3::func_decl get_array_rec_func(const MemoryObjectPtr array);
+            z3::func_decl get_array_rec_func(const MemoryObject* array);
 
             /**
              * @brief get base case for array summarization
              * @return A pair of (condition , transition)
              */
-            std::pair<z3::expr, rec_ty> get_array_base_case(const MemoryObjectPtr array);
+            std::pair<z3::expr, rec_ty> get_array_base_case(const MemoryObject* array);
 
             /**
              * @brief convert a finial state to recursive case
@@ -229,7 +290,7 @@ namespace ari_exe {
              * @brief get the frame case for array summarization
              * @return A pair of (condition , transition)
              */
-            std::pair<z3::expr, rec_ty> get_array_frame_case(std::vector<z3::expr> conditions, const MemoryObjectPtr array);
+            std::pair<z3::expr, rec_ty> get_array_frame_case(std::vector<z3::expr> conditions, const MemoryObject* array);
 
             /**
              * @brief get all header phis in order
@@ -292,6 +353,32 @@ namespace ari_exe {
              */
             initial_ty get_initial_values();
 
+            /**
+             * @brief get the values of the parent state the summary depends on, i.e., initial values of header phis,
+             *        values defined outside the loop and used in it, and memory objects accessed by the loop,
+             *        or all accessible objects if they are not known, see get_accessed_scalars.
+             *        Summaries computed for the same entry values are the same.
+             * @details values are given by the terms they are stored as, nothing is simplified or materialized,
+             *          so that building the values is linear in their size.
+             */
+            z3::expr_vector get_entry_values();
+
+            /**
+             * @brief get the scalar objects of the parent state loaded or stored by the loop
+             * @return nullopt if the loop may access objects other than those given by pointers defined
+             *         outside of it, e.g., through pointers computed in the loop or calls
+             * @details the loop body is walked once, later calls return the same objects
+             */
+            const std::optional<std::vector<const MemoryObject*>>& get_accessed_scalars();
+
+            std::optional<std::vector<const MemoryObject*>> compute_accessed_scalars();
+
+            /**
+             * @brief get the conjuncts of the parent path condition that are related to the entry values
+             *        through shared symbols, other conjuncts do not affect the summary.
+             */
+            z3::expr get_entry_condition(const z3::expr_vector& entry_values);
+
             /**
              * @brief get predecessor of the loop
              */
@@ -302,6 +389,17 @@ namespace ari_exe {
              */
             state_ptr parent_state;
 
+            /**
+             * @brief the slice of the parent path condition used for summarization, see get_entry_condition
+             */
+            std::optional<z3::expr> entry_condition;
+
+            /**
+             * @brief the result of compute_accessed_scalars, valid once accessed_scalars_computed is set
+             */
+            std::optional<std::vector<const MemoryObject*>> accessed_scalars;
+            bool accessed_scalars_computed = false;
+
             /**
              * @brief log info
              */
@@ -1,15 +1,17 @@
 #include "LoopSummary.h"
 
+#include <algorithm>
+
 using namespace ari_exe;
 
 LoopSummary::LoopSummary(const z3::expr_vector& params, const z3::expr_vector& summary, const z3::expr_vector& closed_form, const z3::expr& constraints, const std::vector<llvm::Value*>& modified_values, std::optional<z3::expr> N): \
-                         params(params), summary_exact(summary), summary_closed_form(closed_form), is_over_approx(false), constraints(constraints), modified_values(modified_values), N(N) {}
+                         params(params), summary_exact(summary), summary_closed_form(closed_form), is_over_approx(false), constraints(constraints), modified_values(modified_values), N(N), entry_values(params.ctx()) {}
 
 // LoopSummary::LoopSummary(const z3::expr_vector& params, const closed_form_ty& summary, const z3::expr& constraints, const std::vector<llvm::Value*>& modified_values, std::optional<z3::expr> N): params(params), summary_exact(summary), summary_closed_form(params.ctx()), summary_over_approx(summary), is_over_approx(true), constraints(constraints), modified_values(modified_values), N(N) {}
 LoopSummary::LoopSummary(const z3::expr_vector& params, const z3::expr_vector& exact_summary, const z3::expr_vector& closed_form, const closed_form_ty& over_approximated, const z3::expr& constraints, std::optional<z3::expr> N):
-                         params(params), summary_exact(exact_summary), summary_closed_form(closed_form), summary_over_approx(over_approximated), is_over_approx(true), constraints(constraints), N(N) {}
+                         params(params), summary_exact(exact_summary), summary_closed_form(closed_form), summary_over_approx(over_approximated), is_over_approx(true), constraints(constraints), N(N), entry_values(params.ctx()) {}
 
-LoopSummary::LoopSummary(const LoopSummary& other): params(other.params), summary_exact(other.summary_exact), summary_closed_form(other.summary_closed_form), summary_over_approx(other.summary_over_approx), is_over_approx(other.is_over_approx), constraints(other.constraints), modified_values(other.modified_values), N(other.N), invariant_results(other.invariant_results) {}
+LoopSummary::LoopSummary(const LoopSummary& other): params(other.params), summary_exact(other.summary_exact), summary_closed_form(other.summary_closed_form), summary_over_approx(other.summary_over_approx), is_over_approx(other.is_over_approx), constraints(other.constraints), modified_values(other.modified_values), N(other.N), invariant_results(other.invariant_results), entry_values(other.entry_values), kernels(other.kernels), kernels_ind_var(other.kernels_ind_var) {}
 
 z3::expr_vector
 LoopSummary::evaluate(const z3::expr_vector& args) {
@@ -31,8 +33,58 @@ LoopSummary::evaluate_expr(z3::expr expr) const {
     return expr.substitute(params, summary_closed_form);
 }
 
+std::optional<z3::expr_vector>
+LoopSummary::evaluate_at(const z3::expr_vector& args, const z3::expr& ind_var, const z3::expr& iteration) const {
+    if (is_over_approx || args.size() != params.size()) return std::nullopt;
+    auto iteration_value = Rational::from_numeral(iteration);
+    if (!iteration_value.has_value()) return std::nullopt;
+
+    z3::expr_vector variables = params;
+    variables.push_back(ind_var);
+    if (!kernels || !kernels_ind_var.has_value() || !z3::eq(*kernels_ind_var, ind_var)) {
+        kernels = std::make_shared<std::vector<std::optional<ClosedFormKernel>>>();
+        for (auto closed_form : summary_closed_form) {
+            kernels->push_back(ClosedFormKernel::compile(closed_form, variables));
+        }
+        kernels_ind_var = ind_var;
+    }
+
+    // only the values used by the kernels are converted
+    std::vector<std::optional<Rational>> values(args.size());
+    for (unsigned i = 0; i < args.size(); i++) {
+        bool used = std::any_of(kernels->begin(), kernels->end(), [&](const std::optional<ClosedFormKernel>& kernel) {
+            return kernel.has_value() && kernel->uses(i);
+        });
+        if (used) values[i] = Rational::from_numeral(args[i]);
+    }
+    values.push_back(iteration_value);
+
+    z3::expr_vector result(args.ctx());
+    for (unsigned i = 0; i < kernels->size(); i++) {
+        auto& kernel = (*kernels)[i];
+        if (!kernel.has_value()) return std::nullopt;
+        auto value = kernel->evaluate(values);
+        bool is_int = summary_closed_form[i].is_int();
+        if (!value.has_value() || (is_int && !value->is_integer())) return std::nullopt;
+        result.push_back(value->to_expr(args.ctx(), is_int));
+    }
+    return result;
+}
+
 void
 LoopSummary::add_closed_form(const z3::expr& param, const z3::expr& closed_form) {
     params.push_back(param);
     summary_closed_form.push_back(closed_form);
+    kernels.reset();
+    kernels_ind_var.reset();
+}
+
+bool
+LoopSummary::is_computed_for(const z3::expr_vector& values) const {
+    if (values.size() != entry_values.size()) return false;
+    for (unsigned i = 0; i < values.size(); i++) {
+        // z3 expressions are hash-consed, so equal expressions are the same ast
+        if (!z3::eq(values[i], entry_values[i])) return false;
+    }
+    return true;
 }
@@ -7,7 +7,10 @@
 
 #include <utility>
 #include <map>
+#include <memory>
+#include <optional>
 #include "rec_solver.h"
+#include "ClosedFormKernel.h"
 
 namespace ari_exe {
 
@@ -49,6 +52,17 @@ namespace ari_exe {
              */
             z3::expr evaluate_expr(z3::expr expr) const;
 
+            /**
+             * @brief evaluate the closed-form solutions numerically by ClosedFormKernel,
+             *        without building z3 terms
+             * @param args numerals of the params, only those used by the closed forms are needed
+             * @param ind_var the iteration variable of the closed forms
+             * @param iteration the numeral of the iteration to evaluate at
+             * @return numerals of the values of the closed forms, or nullopt if some closed form
+             *         is not supported by the kernel or needs a value that is not a numeral
+             */
+            std::optional<z3::expr_vector> evaluate_at(const z3::expr_vector& args, const z3::expr& ind_var, const z3::expr& iteration) const;
+
             std::vector<VeriResult>
             get_invariant_results() const { return invariant_results; }
 
@@ -105,6 +119,16 @@ namespace ari_exe {
                 return summary_closed_form;
             }
 
+            /**
+             * @brief record the entry values the summary is computed for, see LoopSummarizer::get_entry_values
+             */
+            void set_entry_values(const z3::expr_vector& values) { entry_values = values; }
+
+            /**
+             * @brief check if the summary is computed for the given entry values
+             */
+            bool is_computed_for(const z3::expr_vector& values) const;
+
             /**
              * @brief The over-approximated summary of the loop
              * @details if is_over_approx is true, which means the loop summary is
@@ -160,6 +184,23 @@ namespace ari_exe {
             bool is_over_approx;
             
             std::vector<VeriResult> invariant_results;
+
+            /**
+             * @brief values of the entry state the summary is computed for
+             */
+            z3::expr_vector entry_values;
+
+            /**
+             * @brief the kernels of the closed forms over params and kernels_ind_var,
+             *        compiled by evaluate_at and shared by the copies of the summary
+             */
+            mutable std::shared_ptr<std::vector<std::optional<ClosedFormKernel>>> kernels;
+
+            /**
+             * @brief the iteration variable the kernels are compiled for,
+             *        they are compiled again if evaluate_at is given another one
+             */
+            mutable std::optional<z3::expr> kernels_ind_var;
     };
 }
 #endif
@@ -3,11 +3,15 @@
 using namespace ari_exe;
 
 
-// MStack::StackFrame&
-// MStack::push_frame(const StackFrame& frame) {
-//     frames.push(frame);
-//     return frames.top();
-// }
+MStack::StackFrame&
+MStack::push_frame(const StackFrame& frame) {
+    return *frames.emplace_back(frame);
+}
+
+MStack::StackFrame&
+MStack::push_frame(StackFrame&& frame) {
+    return *frames.push_back(std::move(frame));
+}
 
 std::string
 MStack::StackFrame::to_string() const {
@@ -21,11 +25,35 @@ MStack::StackFrame::to_string() const {
     return res;
 }
 
+bool
+MStack::StackFrame::merge(const StackFrame& other, const z3::expr& cond) {
+    if (func != other.func || prev_pc != other.prev_pc || !z3::eq(base.as_expr(), other.base.as_expr())) return false;
+    for (const auto& [value, obj] : other.temp_objects) {
+        auto it = temp_objects.find(value);
+        if (it == temp_objects.end()) {
+            // defined only on the path of other, so it is not used after the merge point
+            temp_objects.insert_or_assign(value, obj);
+        } else if (!it->second.merge(obj, cond)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 MemoryObjectPtr
-MStack::StackFrame::get_object(llvm::Value* v) const {
+MStack::StackFrame::get_object(llvm::Value* v) {
     auto it = temp_objects.find(v);
     if (it != temp_objects.end()) {
-        return const_cast<MemoryObjectPtr>(&it->second);
+        return &it->second;
+    }
+    return nullptr;
+}
+
+const MemoryObject*
+MStack::StackFrame::peek_object(llvm::Value* v) const {
+    auto it = temp_objects.find(v);
+    if (it != temp_objects.end()) {
+        return &it->second;
     }
     return nullptr;
 }
@@ -35,33 +63,46 @@ MStack::push_frame(llvm::Function* func) {
     int num_objs = objects.size();
     auto& z3ctx = AnalysisManager::get_ctx();
     auto base = Expression(z3ctx.int_val(num_objs));
-    frames.push(StackFrame(base, func));
-    return frames.top();
+    return *frames.push_back(StackFrame(base, func));
 }
 
 std::vector<MemoryObjectPtr>
-MStack::get_top_objects() const {
+MStack::get_top_objects() {
     std::vector<MemoryObjectPtr> top_objects;
-    auto& top_frame = frames.top();
-    auto cur_base = top_frame.base.as_expr();
+    auto cur_base = frames.peek_back().base.as_expr();
     assert(cur_base.is_numeral() && "Only support concrete get_top_objects for now");
     int cur_base_int = cur_base.get_numeral_int();
     for (int i = cur_base_int; i < objects.size(); ++i) {
-        top_objects.push_back(const_cast<MemoryObjectPtr>(&objects[i]));
+        top_objects.push_back(objects.get(i));
     }
     return top_objects;
 }
 
-MStack::StackFrame&
+std::vector<const MemoryObject*>
+MStack::peek_top_objects() const {
+    std::vector<const MemoryObject*> top_objects;
+    auto cur_base = frames.peek_back().base.as_expr();
+    assert(cur_base.is_numeral() && "Only support concrete get_top_objects for now");
+    int cur_base_int = cur_base.get_numeral_int();
+    for (int i = cur_base_int; i < objects.size(); ++i) {
+        top_objects.push_back(&objects.peek(i));
+    }
+    return top_objects;
+}
+
+MStack::StackFrame
 MStack::pop_frame() {
     assert(!frames.empty());
-    auto& frame = frames.top();
+    auto frame = frames.take_back();
     // objects.resize(frame.base.as_expr().get_numeral_int());
 
     while (objects.size() > frame.base.as_expr().get_numeral_int()) {
+        auto it = object_index.find(objects.peek(objects.size() - 1).get_llvm_value());
+        if (it != object_index.end() && it->second == objects.size() - 1) {
+            object_index.erase(it);
+        }
         objects.pop_back();
     }
-    frames.pop();
     return frame;
 }
 
@@ -77,8 +118,7 @@ MStack::store(const MemoryAddress_ty& addr, const Expression& value) {
     auto base_z3 = addr.base.as_expr();
     assert(base_z3.is_numeral() && "Only support concrete store for now");
     int base = base_z3.get_numeral_int();
-    auto& obj = objects[base];
-    obj.write(addr.offset, value);
+    objects.get(base)->write(addr.offset, value);
 }
 
 MemoryObjectPtr
@@ -103,36 +143,56 @@ MStack::allocate(llvm::Value* value, z3::expr_vector dims) {
     auto undef_func= z3ctx.function(name.c_str(), indices_sorts, z3ctx.int_sort());
     // Expression undef(z3ctx.int_const(name.c_str()), indices_sorts, z3ctx.int_sort());
     Expression undef(undef_func(indices));
-    objects.emplace_back(value, mem_obj_addr, undef, std::nullopt, indices, sizes, value->getName().str());
+    auto obj = objects.emplace_back(value, mem_obj_addr, undef, std::nullopt, indices, sizes, value->getName().str());
+    object_index.emplace(value, id);
     
     put_temp(value, mem_obj_addr);
 
-    return &objects.back();
+    return obj;
 }
 
 MemoryObjectPtr
-MStack::get_object(llvm::Value* v) const {
+MStack::get_object(llvm::Value* v) {
+    // look the value up before unsharing the top frame, which may not hold it
+    if (frames.peek_back().peek_object(v)) {
+        return frames.back()->get_object(v);
+    }
+
+    auto it = object_index.find(v);
+    if (it != object_index.end()) {
+        return objects.get(it->second);
+    }
+    return nullptr;
+}
 
-    auto obj = frames.top().get_object(v);
-    if (obj) {
+const MemoryObject*
+MStack::peek_object(llvm::Value* v) const {
+    if (auto obj = frames.peek_back().peek_object(v)) {
         return obj;
     }
 
-    auto it = std::find_if(objects.begin(), objects.end(),
-                           [v](const MemoryObject& obj) { return obj.get_llvm_value() == v; });
-    if (it != objects.end()) {
-        return const_cast<MemoryObjectPtr>(&(*it));
+    auto it = object_index.find(v);
+    if (it != object_index.end()) {
+        return &objects.peek(it->second);
     }
     return nullptr;
 }
 
 MemoryObjectPtr
-MStack::get_object(const MemoryAddress_ty& addr) const {
+MStack::get_object(const MemoryAddress_ty& addr) {
     assert(addr.loc == STACK);
     auto base_z3 = addr.base.as_expr();
     assert(base_z3.is_numeral() && "Only support concrete get_object for now");
     int base = base_z3.get_numeral_int();
-    return const_cast<MemoryObjectPtr>(&objects[base]);
+    return objects.get(base);
+}
+
+const MemoryObject*
+MStack::peek_object(const MemoryAddress_ty& addr) const {
+    assert(addr.loc == STACK);
+    auto base_z3 = addr.base.as_expr();
+    assert(base_z3.is_numeral() && "Only support concrete get_object for now");
+    return &objects.peek(base_z3.get_numeral_int());
 }
 
 MemoryObjectPtr
@@ -152,35 +212,68 @@ MStack::StackFrame::put_temp(llvm::Value* llvm_value, const MemoryAddress_ty& pt
 
 MemoryObjectPtr
 MStack::put_temp(llvm::Value* llvm_value, const Expression& value) {
-    return frames.top().put_temp(llvm_value, value);
+    return frames.back()->put_temp(llvm_value, value);
 }
 
 MemoryObjectPtr
 MStack::put_temp(llvm::Value* llvm_value, const MemoryAddress_ty& ptr_value) {
-    return frames.top().put_temp(llvm_value, ptr_value);
+    return frames.back()->put_temp(llvm_value, ptr_value);
 }
 
 std::vector<MemoryObjectPtr>
-MStack::get_arrays() const {
+MStack::get_arrays() {
     std::vector<MemoryObjectPtr> arrays;
-    for (const auto& obj : objects) {
-        if (obj.is_array()) {
-            arrays.push_back(const_cast<MemoryObjectPtr>(&obj));
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects.peek(i).is_array()) {
+            arrays.push_back(objects.get(i));
         }
     }
     return arrays;
 }
 
+std::vector<const MemoryObject*>
+MStack::peek_arrays() const {
+    std::vector<const MemoryObject*> arrays;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        if (objects.peek(i).is_array()) {
+            arrays.push_back(&objects.peek(i));
+        }
+    }
+    return arrays;
+}
+
+void
+MStack::add_footprint(Footprint& fp) const {
+    fp.add(sizeof(MStack));
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const auto& frame = frames.peek(i);
+        fp.add(sizeof(StackFrame));
+        fp.add(frame.base);
+        for (const auto& [_, obj] : frame.temp_objects) obj.add_footprint(fp);
+    }
+    for (size_t i = 0; i < objects.size(); ++i) {
+        objects.peek(i).add_footprint(fp);
+    }
+}
+
+bool
+MStack::merge(const MStack& other, const z3::expr& cond) {
+    if (object_index != other.object_index) return false;
+    auto merge_frame = [&](StackFrame& frame, const StackFrame& other_frame) { return frame.merge(other_frame, cond); };
+    auto merge_object = [&](MemoryObject& obj, const MemoryObject& other_obj) { return obj.merge(other_obj, cond); };
+    return frames.merge(other.frames, merge_frame) && objects.merge(other.objects, merge_object);
+}
+
 std::string
 MStack::to_string() const {
     std::string res = "MStack:\n";
-    auto& top_frame = frames.top();
+    auto& top_frame = frames.peek_back();
     res += "Top frame:\n";
     res += top_frame.to_string();
     res += std::to_string(objects.size()) + " objects: \n";
     res += "************\n";
     for (int i = top_frame.base.as_expr().get_numeral_int(); i < objects.size(); ++i) {
-        res += objects[i].to_string();
+        res += objects.peek(i).to_string();
         res += "************\n";
     }
     return res;
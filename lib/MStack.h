@@ -9,10 +9,11 @@
 #define ASTACK_H
 
 #include "MemoryObject.h"
+#include "ObjectStore.h"
 
 #include <map>
+#include <unordered_map>
 #include <vector>
-#include <stack>
 #include <optional>
 
 #include "z3++.h"
@@ -26,10 +27,14 @@ namespace ari_exe {
             struct StackFrame {
                 StackFrame() = default;
                 StackFrame(const Expression& base, llvm::Function* func): base(base), func(func) {}
-                StackFrame(const StackFrame& other): prev_pc(other.prev_pc), base(other.base), temp_objects(other.temp_objects), func(other.func) {}
+                StackFrame(const StackFrame& other) = default;
+                StackFrame(StackFrame&& other) = default;
                 StackFrame& operator=(const StackFrame&) = default;
+                StackFrame& operator=(StackFrame&&) = default;
 
-                MemoryObjectPtr get_object(llvm::Value* v) const;
+                MemoryObjectPtr get_object(llvm::Value* v);
+
+                const MemoryObject* peek_object(llvm::Value* v) const;
 
                 AInstruction* prev_pc = nullptr;
 
@@ -43,28 +48,35 @@ namespace ari_exe {
 
                 std::string to_string() const;
 
-                std::map<llvm::Value*, MemoryObject> temp_objects;
+                /**
+                 * @brief merge the temporary objects of other into this frame, see MemoryObject::merge.
+                 *        Temporaries only in other are copied.
+                 */
+                bool merge(const StackFrame& other, const z3::expr& cond);
+
+                std::unordered_map<llvm::Value*, MemoryObject> temp_objects;
                 llvm::Function* func;
             };
 
         public:
             MStack() = default;
-            MStack(const MStack& other): frames(other.frames), objects(other.objects) {}
+            MStack(const MStack& other): frames(other.frames), objects(other.objects), object_index(other.object_index) {}
             MStack& operator=(const MStack&) = default;
 
             // push a new frame to the stack
             StackFrame& push_frame(const StackFrame& frame);
+            StackFrame& push_frame(StackFrame&& frame);
 
             // push a new empty frame to the stack
             StackFrame& push_frame(llvm::Function* func=nullptr);
 
-            // pop the top frame from the stack
-            StackFrame& pop_frame();
+            // pop the top frame from the stack and return it
+            StackFrame pop_frame();
 
             // get the top frame of the stack
             StackFrame& top_frame() { 
                 assert(!frames.empty() && "Stack is empty");
-                return frames.top(); 
+                return *frames.back();
             }
 
             size_t size() const {
@@ -81,22 +93,50 @@ namespace ari_exe {
             MemoryObjectPtr put_temp(llvm::Value* llvm_value, const MemoryAddress_ty& ptr_value);
 
             // Get the object created by the given llvm::Value
-            MemoryObjectPtr get_object(llvm::Value* v) const;
+            MemoryObjectPtr get_object(llvm::Value* v);
+
+            // get the object created by the given llvm::Value for reading only, never clones
+            const MemoryObject* peek_object(llvm::Value* v) const;
 
             // given a memory address, get the memory object pointed by the base
-            MemoryObjectPtr get_object(const MemoryAddress_ty& addr) const;
+            MemoryObjectPtr get_object(const MemoryAddress_ty& addr);
+
+            // given a memory address, get the memory object pointed by the base for reading only, never clones
+            const MemoryObject* peek_object(const MemoryAddress_ty& addr) const;
 
             // get all objects accessible in the top frame
-            std::vector<MemoryObjectPtr> get_top_objects() const;
+            std::vector<MemoryObjectPtr> get_top_objects();
+
+            // get all objects accessible in the top frame for reading only, never clones
+            std::vector<const MemoryObject*> peek_top_objects() const;
 
-            std::vector<MemoryObjectPtr> get_arrays() const;
+            std::vector<MemoryObjectPtr> get_arrays();
+
+            std::vector<const MemoryObject*> peek_arrays() const;
 
             std::string to_string() const;
 
+            /**
+             * @brief merge other into this stack, so that objects have their values in this stack if cond holds
+             *        and their values in other otherwise.
+             * @return false if the stacks have different frames or objects, the stack may be partially merged
+             */
+            bool merge(const MStack& other, const z3::expr& cond);
+
+            /**
+             * @brief add the bytes held by all frames and objects to the footprint
+             */
+            void add_footprint(Footprint& fp) const;
+
         private:
-            std::stack<StackFrame> frames;
+            // frames are shared with copies of the stack, only the top frame is cloned when a copy modifies it
+            ObjectStore<StackFrame> frames;
+
+            // objects allocated in all frames, indexed by their base addresses
+            ObjectStore<MemoryObject> objects;
 
-            std::vector<MemoryObject> objects;
+            // the handle of the first object allocated for each value
+            std::unordered_map<llvm::Value*, size_t> object_index;
 
             std::map<llvm::Value*, int> value_counter;
     };
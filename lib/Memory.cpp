@@ -9,108 +9,119 @@ using namespace ari_exe;
 //     m_heap.insert_or_assign(value, mem_obj);
 // }
 
-Memory::Memory() {
-    // It is necessary to reserve enough space to avoid reallocation,
-    // because all objects created are then accessed through pointers to
-    // members of m_objects. If reallocation happens, the pointers will be invalidated.
-    m_objects.reserve(100); 
-}
+Memory::Memory() {}
 
+// objects are shared with other until either side accesses them
 Memory::Memory(const Memory& other)
-    : m_stack(other.m_stack), m_objects(other.m_objects), m_variables(other.m_variables) {
-    // It is necessary to reserve enough space to avoid reallocation,
-    // because all objects created are then accessed through pointers to
-    // members of m_objects. If reallocation happens, the pointers will be invalidated.
-    m_objects.reserve(100);
-}
+    : m_stack(other.m_stack), m_objects(other.m_objects), m_variables(other.m_variables), m_variable_index(other.m_variable_index) {}
 
 MemoryObjectPtr
 Memory::allocate(llvm::Value* value, z3::expr_vector dims) {
     return m_stack.allocate(value, dims);
 }
 
+/**
+ * @brief collect the non-zero elements of a constant initializer of an integer array
+ * @param prefix the index of the sub-array initialized by c
+ * @return false if some elements are not given by c, e.g., strings and unsupported constants
+ */
+static bool
+collect_initializer(const llvm::Constant* c, std::vector<int64_t>& prefix,
+                    std::vector<std::pair<std::vector<int64_t>, int64_t>>& elements) {
+    if (llvm::isa<llvm::ConstantAggregateZero>(c)) {
+        return true;
+    } else if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(c)) {
+        if (!constant->isZero()) elements.emplace_back(prefix, constant->getSExtValue());
+        return true;
+    } else if (auto data = llvm::dyn_cast<llvm::ConstantDataArray>(c)) {
+        // strings are only used for messages, so they are left unknown
+        if (data->isCString() || !data->getElementType()->isIntegerTy()) return false;
+        for (unsigned i = 0; i < data->getNumElements(); i++) {
+            auto element = data->getElementAsAPInt(i);
+            if (element.isZero()) continue;
+            prefix.push_back(i);
+            elements.emplace_back(prefix, element.getSExtValue());
+            prefix.pop_back();
+        }
+        return true;
+    } else if (auto array = llvm::dyn_cast<llvm::ConstantArray>(c)) {
+        for (unsigned i = 0; i < array->getNumOperands(); i++) {
+            prefix.push_back(i);
+            bool is_complete = collect_initializer(array->getOperand(i), prefix, elements);
+            prefix.pop_back();
+            if (!is_complete) return false;
+        }
+        return true;
+    }
+    llvm::errs() << "Unsupported global variable initializer type\n";
+    return false;
+}
+
 MemoryObjectPtr
 Memory::add_global(llvm::GlobalVariable& gv) {
-    auto manager = AnalysisManager::get_instance();
-    auto& z3ctx = manager->get_z3ctx();
+    auto& z3ctx = AnalysisManager::get_ctx();
 
     llvm::Type* value_type = gv.getValueType();
     auto initial_value = gv.getInitializer();
     z3::expr_vector dims(z3ctx);
-    z3::expr value(z3ctx);
-    z3::expr constraints = z3ctx.bool_val(true);
-    z3::expr_vector indicies(z3ctx);
-    // assuming it is 1-d array
-    indicies.push_back(AnalysisManager::get_ith_array_index(0));
-    if (value_type->isArrayTy()) {
-        auto func = z3ctx.function(gv.getName().str().c_str(), z3ctx.int_sort(), z3ctx.int_sort());
-        value = func(indicies);
-        // implement for 1-d array first
-        // TODO: implement for multi-d array
-        assert(value_type->getArrayElementType()->isIntegerTy());
-        if (auto zero = dyn_cast_or_null<llvm::ConstantAggregateZero>(initial_value)) {
-            // value = z3::const_array(z3ctx.int_sort(), z3ctx.int_val(0));
-            for (int i = 0; i < value_type->getArrayNumElements(); i++) {
-                constraints = constraints && func(i) == z3ctx.int_val(0);
-            }
-        } else if (auto array = dyn_cast_or_null<llvm::ConstantDataArray>(initial_value)) {
-            if (!array->isCString()) {
-                for (int i = 0; i < value_type->getArrayNumElements(); i++) {
-                    constraints = constraints && func(i) == z3ctx.int_val(array->getElementAsInteger(i));
-                }
-            }
-            // if (array->isCString()) {
-            //     // auto arr_sort = z3ctx.array_sort(z3ctx.int_sort(), z3ctx.int_sort());
-            //     // value = z3ctx.constant(gv.getName().str().c_str(), arr_sort);
-            //     // auto str = array->getAsString();
-            //     // value = z3ctx.string_val(array->getAsCString().str());
-            //     for (int i = 0; i < value_type->getArrayNumElements(); i++) {
-            //         constraints = constraints && func(i) == z3ctx.int_val(array->getElementAsInteger(i));
-            //     }
-
-            // } else {
-            //     // only initialize the first initialized elemenets,
-            //     // not sure if need to zero fill the rest
-            //     // auto arr_sort = z3ctx.array_sort(z3ctx.int_sort(), z3ctx.int_sort());
-            //     // value = z3ctx.constant(gv.getName().str().c_str(), arr_sort);
-            //     for (int i = 0; i < array->getNumElements(); i++) {
-            //         // TODO: support other types
-            //         auto element = array->getElementAsInteger(i);
-            //         value = z3::store(value, z3ctx.int_val(i), z3ctx.int_val(element));
-            //     }
-            // }
-        } else {
-            llvm::errs() << "Unsupported global variable initializer type\n";
-        }
-        dims.push_back(z3ctx.int_val(value_type->getArrayNumElements()));
-    } else if (value_type->isIntegerTy()) {
+    for (auto type = value_type; type->isArrayTy(); type = type->getArrayElementType()) {
+        dims.push_back(z3ctx.int_val(type->getArrayNumElements()));
+    }
+    auto obj_ptr = heap_alloca(&gv, dims);
+    obj_ptr->set_constraints(z3ctx.bool_val(true));
+
+    if (dims.empty()) {
         if (auto constant = dyn_cast_or_null<llvm::ConstantInt>(initial_value)) {
-            value = z3ctx.int_val(constant->getSExtValue());
+            obj_ptr->write(Expression(z3ctx.int_val(constant->getSExtValue())));
         } else {
             llvm::errs() << "Unsupported global variable initializer type\n";
         }
+        return obj_ptr;
+    }
+
+    // The initializer is encoded in the content of the array instead of constraints on every element:
+    // the untouched elements are zero, and the non-zero ones are stores on top of it,
+    // so only the elements that are actually read show up in queries.
+    // If the initializer is not complete, the array keeps its unknown content.
+    std::vector<int64_t> prefix;
+    std::vector<std::pair<std::vector<int64_t>, int64_t>> elements;
+    if (!initial_value || !collect_initializer(initial_value, prefix, elements)) {
+        return obj_ptr;
+    }
+    obj_ptr->write(Expression(z3ctx.int_val(0)));
+    if (elements.empty()) return obj_ptr;
+    obj_ptr->set_array_backend(MemoryObject::THEORY);
+    for (const auto& [index, element] : elements) {
+        std::vector<Expression> index_exprs;
+        for (auto i : index) index_exprs.emplace_back(z3ctx.int_val(i));
+        obj_ptr->write(index_exprs, Expression(z3ctx.int_val(element)));
     }
-    auto obj_ptr = heap_alloca(&gv, dims);
-    obj_ptr->write(Expression(value));
-    obj_ptr->set_constraints(constraints);
     return obj_ptr;
 }
 
 MemoryObjectPtr
-Memory::get_object(llvm::Value* value) const {
-    // if value is constant, return the constant value
-    auto manager = AnalysisManager::get_instance();
-    auto& z3ctx = manager->get_z3ctx();
-
+Memory::get_object(llvm::Value* value) {
     auto stack_query = m_stack.get_object(value);
     if (stack_query) {
         return stack_query;
     }
 
-    auto it = std::find_if(m_variables.begin(), m_variables.end(),
-                           [value](const MemoryObject& obj) { return obj.get_llvm_value() == value; });
-    if (it != m_variables.end()) {
-        return const_cast<MemoryObjectPtr>(&(*it));
+    auto it = m_variable_index.find(value);
+    if (it != m_variable_index.end()) {
+        return m_variables.get(it->second);
+    }
+    return nullptr;
+}
+
+const MemoryObject*
+Memory::peek_object(llvm::Value* value) const {
+    if (auto stack_query = m_stack.peek_object(value)) {
+        return stack_query;
+    }
+
+    auto it = m_variable_index.find(value);
+    if (it != m_variable_index.end()) {
+        return &m_variables.peek(it->second);
     }
     return nullptr;
 }
@@ -132,24 +143,69 @@ Memory::store(const MemoryAddress_ty& target, const Expression& val) {
 }
 
 MemoryObjectPtr
-Memory::get_object(const MemoryAddress_ty& addr) const {
+Memory::get_object(const MemoryAddress_ty& addr) {
     if (addr.loc == STACK) {
         return m_stack.get_object(addr);
     } else {
         auto base = addr.base.as_expr();
         if (base.is_numeral()) {
-            return const_cast<MemoryObjectPtr>(&m_objects[base.get_numeral_int()]);
+            return m_objects.get(base.get_numeral_int());
+        }
+    }
+    return nullptr;
+}
+
+const MemoryObject*
+Memory::peek_object(const MemoryAddress_ty& addr) const {
+    if (addr.loc == STACK) {
+        return m_stack.peek_object(addr);
+    } else {
+        auto base = addr.base.as_expr();
+        if (base.is_numeral()) {
+            return &m_objects.peek(base.get_numeral_int());
         }
     }
     return nullptr;
 }
 
+MemoryAddress_ty
+Memory::resolve(const MemoryObject& ptr) const {
+    assert(ptr.is_pointer() && "Pointer object expected");
+    auto addr = ptr.get_ptr_value();
+    auto pointed_obj = peek_object(addr);
+    if (pointed_obj == nullptr || !pointed_obj->is_pointer()) {
+        return addr;
+    }
+    // the offsets of this pointer apply to the object pointed by the inner one
+    auto inner = resolve(*pointed_obj);
+    inner.offset.insert(inner.offset.end(), addr.offset.begin(), addr.offset.end());
+    return inner;
+}
+
+MemoryAddress_ty
+Memory::resolve(llvm::Value* ptr) const {
+    auto ptr_obj = peek_object(ptr);
+    assert(ptr_obj && "Pointer object must exist");
+    return resolve(*ptr_obj);
+}
+
 std::vector<MemoryObjectPtr>
-Memory::get_arrays() const {
+Memory::get_arrays() {
     auto arrays = m_stack.get_arrays();
-    for (auto& obj : m_objects) {
-        if (obj.is_array()) {
-            arrays.push_back(const_cast<MemoryObjectPtr>(&obj));
+    for (size_t i = 0; i < m_objects.size(); ++i) {
+        if (m_objects.peek(i).is_array()) {
+            arrays.push_back(m_objects.get(i));
+        }
+    }
+    return arrays;
+}
+
+std::vector<const MemoryObject*>
+Memory::peek_arrays() const {
+    auto arrays = m_stack.peek_arrays();
+    for (size_t i = 0; i < m_objects.size(); ++i) {
+        if (m_objects.peek(i).is_array()) {
+            arrays.push_back(&m_objects.peek(i));
         }
     }
     return arrays;
@@ -170,13 +226,14 @@ Memory::heap_alloca(llvm::Value* value, z3::expr_vector dims) {
     for (const auto& dim : dims) {
         sizes.emplace_back(dim);
     }
-    auto name = get_z3_name(value->getName().str());
-    auto func = z3ctx.function(name.c_str(), index_sorts, z3ctx.int_sort());
-    auto& obj = m_objects.emplace_back(value, mem_obj_addr, Expression(func(indices)), std::nullopt, indices, sizes, name);
+    auto name = AnalysisManager::get_names().z3_name(value);
+    auto func = z3ctx.function(AnalysisManager::get_names().symbol(value), index_sorts, z3ctx.int_sort());
+    auto obj = m_objects.emplace_back(value, mem_obj_addr, Expression(func(indices)), std::nullopt, indices, sizes, name);
     int ptr_id = m_variables.size();
     MemoryAddress_ty mem_obj_ptr_addr{HEAP, Expression(z3ctx.int_val(ptr_id)), {}};
-    auto obj_ptr = m_variables.emplace_back(value, mem_obj_ptr_addr, Expression(), mem_obj_addr, indices, sizes, name);
-    return &obj;
+    m_variables.emplace_back(value, mem_obj_ptr_addr, Expression(), mem_obj_addr, indices, sizes, name);
+    m_variable_index.emplace(value, ptr_id);
+    return obj;
 
 }
 
@@ -191,8 +248,8 @@ Memory::put_temp(llvm::Value* value, const MemoryAddress_ty& addr) {
 }
 
 MemoryObjectPtr
-Memory::get_object_pointed_by(llvm::Value* value) const {
-    auto m_obj = get_object(value);
+Memory::get_object_pointed_by(llvm::Value* value) {
+    auto m_obj = peek_object(value);
     if (m_obj && m_obj->is_pointer()) {
         auto addr = m_obj->get_ptr_value();
         return get_object(addr);
@@ -200,27 +257,64 @@ Memory::get_object_pointed_by(llvm::Value* value) const {
     return nullptr;
 }
 
+const MemoryObject*
+Memory::peek_object_pointed_by(llvm::Value* value) const {
+    auto m_obj = peek_object(value);
+    if (m_obj && m_obj->is_pointer()) {
+        return peek_object(m_obj->get_ptr_value());
+    }
+    return nullptr;
+}
+
 std::vector<MemoryObjectPtr>
-Memory::get_accessible_objects() const {
+Memory::get_accessible_objects() {
     auto res = m_stack.get_top_objects();
     for (int i = 0; i < m_objects.size(); ++i) {
-        res.push_back(const_cast<MemoryObjectPtr>(&m_objects[i]));
+        res.push_back(m_objects.get(i));
+    }
+    return res;
+}
+
+std::vector<const MemoryObject*>
+Memory::peek_accessible_objects() const {
+    auto res = m_stack.peek_top_objects();
+    for (int i = 0; i < m_objects.size(); ++i) {
+        res.push_back(&m_objects.peek(i));
     }
     return res;
 }
 
+bool
+Memory::merge(const Memory& other, const z3::expr& cond) {
+    if (m_variable_index != other.m_variable_index) return false;
+    auto merge_object = [&](MemoryObject& obj, const MemoryObject& other_obj) { return obj.merge(other_obj, cond); };
+    return m_stack.merge(other.m_stack, cond) && m_objects.merge(other.m_objects, merge_object) &&
+           m_variables.merge(other.m_variables, merge_object);
+}
+
+void
+Memory::add_footprint(Footprint& fp) const {
+    m_stack.add_footprint(fp);
+    for (size_t i = 0; i < m_objects.size(); ++i) {
+        m_objects.peek(i).add_footprint(fp);
+    }
+    for (size_t i = 0; i < m_variables.size(); ++i) {
+        m_variables.peek(i).add_footprint(fp);
+    }
+}
+
 std::string
 Memory::to_string() const {
     std::string res = "Memory:\n";
     res += "****************** Stack ******************\n";
     res += m_stack.to_string();
     res += "****************** Objects ******************\n";
-    for (const auto& obj : m_objects) {
-        res += obj.to_string();
+    for (size_t i = 0; i < m_objects.size(); ++i) {
+        res += m_objects.peek(i).to_string();
     }
     res += "****************** Variables ******************\n";
-    for (const auto& var : m_variables) {
-        res += var.to_string();
+    for (size_t i = 0; i < m_variables.size(); ++i) {
+        res += m_variables.peek(i).to_string();
     }
     return res;
 }
\ No newline at end of file
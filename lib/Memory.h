@@ -3,10 +3,12 @@
 
 #include <map>
 #include <list>
+#include <unordered_map>
 
 #include "MemoryObject.h"
 #include "AnalysisManager.h"
 #include "MStack.h"
+#include "ObjectStore.h"
 
 #include "z3++.h"
 #include "llvm/IR/Instructions.h"
@@ -53,7 +55,12 @@ namespace ari_exe {
             /**
              * @brief get the object pointed by the given LLVM value, which is assumed to be a pointer
              */
-            MemoryObjectPtr get_object_pointed_by(llvm::Value* value) const;
+            MemoryObjectPtr get_object_pointed_by(llvm::Value* value);
+
+            /**
+             * @brief get the object pointed by the given LLVM value for reading only, never clones
+             */
+            const MemoryObject* peek_object_pointed_by(llvm::Value* value) const;
 
             /**
              * @brief store the value to the address.
@@ -81,14 +88,18 @@ namespace ari_exe {
                 return m_stack.push_frame(frame);
             }
 
+            MStack::StackFrame& push_frame(MStack::StackFrame&& frame) {
+                return m_stack.push_frame(std::move(frame));
+            }
+
             MStack::StackFrame& push_frame(llvm::Function* func) {
                 return m_stack.push_frame(func);
             }
 
             /**
-             * @brief pop the top frame from the stack.
+             * @brief pop the top frame from the stack and return it.
              */
-            MStack::StackFrame& pop_frame() {
+            MStack::StackFrame pop_frame() {
                 return m_stack.pop_frame();
             }
 
@@ -96,12 +107,34 @@ namespace ari_exe {
              * @brief get the memory object created by the given LLVM value.
              * @return the memory object if it exists, otherwise return nullptr.
              */
-            MemoryObjectPtr get_object(llvm::Value* value) const;
+            MemoryObjectPtr get_object(llvm::Value* value);
+
+            /**
+             * @brief get the memory object created by the given LLVM value for reading only.
+             *        Unlike get_object, the object is not unshared from copies of this memory.
+             */
+            const MemoryObject* peek_object(llvm::Value* value) const;
 
             /**
              * @brief Given a memory address, get the memory object pointed by the base
              */
-            MemoryObjectPtr get_object(const MemoryAddress_ty& addr) const;
+            MemoryObjectPtr get_object(const MemoryAddress_ty& addr);
+
+            /**
+             * @brief Given a memory address, get the memory object pointed by the base for reading only.
+             *        Unlike get_object, the object is not unshared from copies of this memory.
+             */
+            const MemoryObject* peek_object(const MemoryAddress_ty& addr) const;
+
+            /**
+             * @brief the address pointed by the pointer object, following pointers to pointers
+             */
+            MemoryAddress_ty resolve(const MemoryObject& ptr) const;
+
+            /**
+             * @brief the address pointed by the given LLVM value, which is assumed to be a pointer
+             */
+            MemoryAddress_ty resolve(llvm::Value* ptr) const;
 
             /**
              * @brief Get the stack size, which is the number of frames in the stack.
@@ -113,14 +146,35 @@ namespace ari_exe {
             /**
              * @brief get all arrays in the memory.
              */
-            std::vector<MemoryObjectPtr> get_arrays() const ;
+            std::vector<MemoryObjectPtr> get_arrays();
+
+            /**
+             * @brief get all arrays in the memory for reading only, never clones
+             */
+            std::vector<const MemoryObject*> peek_arrays() const;
+
+            /**
+             * @brief merge other into this memory, so that objects have their values in this memory if cond holds
+             *        and their values in other otherwise. Objects still shared by both memories are not touched.
+             * @return false if the memories have different layouts, in which case this memory may be partially merged
+             *         and should be discarded
+             */
+            bool merge(const Memory& other, const z3::expr& cond);
 
             // currently, only output the scalar values in the memory
             std::string to_string() const;
 
+            /**
+             * @brief add the bytes held by the stack, globals, and heap objects to the footprint
+             */
+            void add_footprint(Footprint& fp) const;
+
             // Get all memory objects accessible in current state.
             // They globals, heap variables, and local variables in the top frame.
-            std::vector<MemoryObjectPtr> get_accessible_objects() const;
+            std::vector<MemoryObjectPtr> get_accessible_objects();
+
+            // the accessible objects for reading only, never clones
+            std::vector<const MemoryObject*> peek_accessible_objects() const;
 
         private:
             // /**
@@ -130,10 +184,13 @@ namespace ari_exe {
 
             MStack m_stack;
 
-            // all global variables and heap variables
-            std::vector<MemoryObject> m_objects;
+            // all global variables and heap variables, indexed by their base addresses
+            ObjectStore<MemoryObject> m_objects;
+
+            ObjectStore<MemoryObject> m_variables;
 
-            std::vector<MemoryObject> m_variables;
+            // the handle in m_variables of the first variable created for each value
+            std::unordered_map<llvm::Value*, size_t> m_variable_index;
 
             // record the next id for each value
             std::map<llvm::Value*, int> next_id;
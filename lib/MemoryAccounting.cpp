@@ -0,0 +1,141 @@
+#include "MemoryAccounting.h"
+#include "state.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ari_exe;
+
+std::atomic<size_t> MemoryAccounting::live_states{0};
+
+// rough sizes of z3 AST nodes
+static constexpr size_t APP_NODE_BYTES = 32;
+static constexpr size_t ARG_BYTES = 8;
+static constexpr size_t NUMERAL_NODE_BYTES = 48;
+static constexpr size_t QUANTIFIER_NODE_BYTES = 64;
+
+void
+Footprint::add(const z3::expr& e) {
+    if (!e) return;
+    std::vector<z3::expr> todo{e};
+    while (!todo.empty()) {
+        auto cur = todo.back();
+        todo.pop_back();
+        if (!visited.insert(cur.id()).second) continue;
+        if (cur.is_numeral()) {
+            bytes += NUMERAL_NODE_BYTES;
+        } else if (cur.is_app()) {
+            bytes += APP_NODE_BYTES + ARG_BYTES * cur.num_args();
+            for (unsigned i = 0; i < cur.num_args(); ++i) {
+                todo.push_back(cur.arg(i));
+            }
+        } else if (cur.is_quantifier() || cur.is_lambda()) {
+            bytes += QUANTIFIER_NODE_BYTES;
+            todo.push_back(cur.body());
+        } else {
+            bytes += APP_NODE_BYTES;
+        }
+    }
+}
+
+void
+Footprint::add(const z3::expr_vector& v) {
+    bytes += sizeof(z3::expr_vector) + ARG_BYTES * v.size();
+    for (const auto& e : v) add(e);
+}
+
+void
+Footprint::add(const Expression& e) {
+    bytes += sizeof(Expression);
+    add(e.get_conditions());
+    add(e.get_expressions());
+}
+
+size_t
+ari_exe::footprint(const State& state) {
+    Footprint fp;
+    fp.add(sizeof(State));
+    state.memory.add_footprint(fp);
+    fp.add(state.get_path_condition());
+    fp.add(state.verification_condition);
+    fp.add(state.trace.capacity() * sizeof(llvm::BasicBlock*));
+    fp.add(state.nondet_calls.capacity() * sizeof(NondetCall));
+    for (const auto& call : state.nondet_calls) {
+        if (call.value.has_value()) fp.add(call.value.value());
+        if (call.count.has_value()) fp.add(call.count.value());
+    }
+    if (state.model.has_value()) fp.add(sizeof(z3::model));
+    return fp.get_bytes();
+}
+
+MemoryAccounting::MemoryAccounting()
+    : enabled(env_flag("ARITHEXE_MEMORY_ACCOUNTING")), top_n(env_size("ARITHEXE_MEMORY_TOP_STATES", 0)) {}
+
+MemoryAccounting*
+MemoryAccounting::get_instance() {
+    static MemoryAccounting instance;
+    return &instance;
+}
+
+MemoryAccounting::Phase::Phase(const std::string& name) {
+    auto accounting = MemoryAccounting::get_instance();
+    if (!accounting->enabled) return;
+    accounting->phases.push_back(name);
+}
+
+MemoryAccounting::Phase::~Phase() {
+    auto accounting = MemoryAccounting::get_instance();
+    if (!accounting->enabled || accounting->phases.empty()) return;
+    accounting->phases.pop_back();
+}
+
+void
+MemoryAccounting::sample(const State& state) {
+    if (!enabled) return;
+    auto bytes = footprint(state);
+    auto phase = phases.empty() ? std::string("main") : phases.back();
+    auto& phase_stats = stats[phase];
+    phase_stats.samples++;
+    phase_stats.total_bytes += bytes;
+    phase_stats.peak_state_bytes = std::max(phase_stats.peak_state_bytes, bytes);
+    auto live = get_live_states();
+    phase_stats.peak_live_states = std::max(phase_stats.peak_live_states, live);
+    phase_stats.peak_live_bytes = std::max(phase_stats.peak_live_bytes, live * (phase_stats.total_bytes / phase_stats.samples));
+
+    if (top_n == 0 || (heaviest.size() == top_n && heaviest.back().bytes >= bytes)) return;
+    std::string location = "<none>";
+    if (state.pc) {
+        auto inst = state.pc->inst;
+        location = inst->getFunction()->getName().str() + ":" + inst->getParent()->getName().str() + ":" + inst->getOpcodeName();
+    }
+    HeavyState heavy{bytes, phase, location};
+    auto pos = std::upper_bound(heaviest.begin(), heaviest.end(), heavy,
+                                [](const HeavyState& lhs, const HeavyState& rhs) { return lhs.bytes > rhs.bytes; });
+    heaviest.insert(pos, heavy);
+    if (heaviest.size() > top_n) heaviest.pop_back();
+}
+
+void
+MemoryAccounting::clear() {
+    phases.clear();
+    stats.clear();
+    heaviest.clear();
+}
+
+std::string
+MemoryAccounting::to_string() const {
+    std::string res = "MemoryAccounting (" + std::to_string(get_live_states()) + " live states):";
+    for (const auto& [phase, phase_stats] : stats) {
+        res += "\n  " + phase + ": " + std::to_string(phase_stats.samples) + " samples, " +
+               std::to_string(phase_stats.total_bytes / std::max<size_t>(phase_stats.samples, 1)) + " bytes/state on average, " +
+               std::to_string(phase_stats.peak_state_bytes) + " bytes/state at peak, " +
+               std::to_string(phase_stats.peak_live_states) + " live states at peak, ~" +
+               std::to_string(phase_stats.peak_live_bytes) + " live bytes at peak";
+    }
+    for (size_t i = 0; i < heaviest.size(); ++i) {
+        res += "\n  #" + std::to_string(i + 1) + " heaviest state: " + std::to_string(heaviest[i].bytes) +
+               " bytes in " + heaviest[i].phase + " at " + heaviest[i].location;
+    }
+    return res;
+}
@@ -0,0 +1,130 @@
+//----------------------------- MemoryAccounting.h -----------------------------
+//
+// This file contains the estimation of the memory held by states.
+//
+//------------------------------------------------------------------------------------------//
+
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "z3++.h"
+
+namespace ari_exe {
+    class Expression;
+    class State;
+
+    /**
+     * @brief An estimation of the bytes reachable from some objects.
+     * @details Z3 ASTs are counted node by node, and nodes shared by several expressions
+     *          added to the same footprint are counted once. Objects shared between states
+     *          through copy-on-write are counted in the footprint of every state.
+     */
+    class Footprint {
+        public:
+            void add(size_t bytes) { this->bytes += bytes; }
+
+            void add(const z3::expr& e);
+
+            void add(const z3::expr_vector& v);
+
+            void add(const Expression& e);
+
+            size_t get_bytes() const { return bytes; }
+
+        private:
+            // ids of the AST nodes counted so far
+            std::unordered_set<unsigned> visited;
+
+            size_t bytes = 0;
+    };
+
+    /**
+     * @brief the estimated bytes held by the state, see Footprint
+     */
+    size_t footprint(const State& state);
+
+    /**
+     * @brief Memory held by states during the analysis, reported per phase.
+     *        It is enabled by setting ARITHEXE_MEMORY_ACCOUNTING to a non-zero value,
+     *        and the ARITHEXE_MEMORY_TOP_STATES heaviest states are reported, 0 by default.
+     * @details The number of live states is counted exactly. Sampling a state computes its footprint,
+     *          and the live bytes are estimated as the live states times the average sampled footprint.
+     */
+    class MemoryAccounting {
+        public:
+            /**
+             * @brief an RAII scope of a phase, e.g., the execution of a function or the summarization of a loop.
+             *        Nested phases are reported separately, and samples go to the innermost one.
+             */
+            class Phase {
+                public:
+                    explicit Phase(const std::string& name);
+                    ~Phase();
+                    Phase(const Phase&) = delete;
+                    Phase& operator=(const Phase&) = delete;
+            };
+
+            static MemoryAccounting* get_instance();
+
+            bool is_enabled() const { return enabled; }
+
+            /**
+             * @brief compute the footprint of the state and account it to the current phase
+             */
+            void sample(const State& state);
+
+            // called when states are created and destroyed
+            static void on_state_created() { live_states.fetch_add(1, std::memory_order_relaxed); }
+            static void on_state_destroyed() { live_states.fetch_sub(1, std::memory_order_relaxed); }
+
+            static size_t get_live_states() { return live_states.load(std::memory_order_relaxed); }
+
+            /**
+             * @brief drop all statistics
+             */
+            void clear();
+
+            /**
+             * @brief the statistics of all phases and the heaviest states in a human readable form
+             */
+            std::string to_string() const;
+
+        private:
+            MemoryAccounting();
+
+            struct PhaseStats {
+                size_t samples = 0;
+                size_t total_bytes = 0;
+                size_t peak_state_bytes = 0;
+                size_t peak_live_states = 0;
+                size_t peak_live_bytes = 0;
+            };
+
+            struct HeavyState {
+                size_t bytes;
+                std::string phase;
+                std::string location;
+            };
+
+            bool enabled;
+
+            size_t top_n;
+
+            static std::atomic<size_t> live_states;
+
+            std::vector<std::string> phases;
+
+            std::map<std::string, PhaseStats> stats;
+
+            // the heaviest sampled states, from the heaviest to the lightest
+            std::vector<HeavyState> heaviest;
+    };
+} // namespace ari_exe
+
+#endif
@@ -1,8 +1,163 @@
 #include "MemoryObject.h"
+#include "common.h"
+
+#include <cstdlib>
 
 using namespace ari_exe;
 
-std::map<std::string, int> MemoryObject::name_counter;
+/**
+ * @brief number of writes at concrete indices after which an array switches
+ *        to the THEORY backend, 0 disables the switch
+ */
+static size_t
+theory_threshold() {
+    static size_t threshold = env_size("ARITHEXE_ARRAY_THEORY_THRESHOLD", 16);
+    return threshold;
+}
+
+static bool
+is_concrete_index(const z3::expr_vector& index) {
+    for (const auto& i : index) {
+        if (!i.is_numeral()) return false;
+    }
+    return true;
+}
+
+// 1 if two concrete indices are the same, -1 if they differ in a concrete position, 0 if unknown
+static int
+compare_indices(const z3::expr_vector& lhs, const z3::expr_vector& rhs) {
+    bool all_same = true;
+    for (unsigned i = 0; i < lhs.size(); ++i) {
+        if (lhs[i].is_numeral() && rhs[i].is_numeral()) {
+            if (!z3::eq(lhs[i], rhs[i])) return -1;
+        } else if (!z3::eq(lhs[i], rhs[i])) {
+            all_same = false;
+        }
+    }
+    return all_same ? 1 : 0;
+}
+
+Expression
+MemoryObject::get_value() const {
+    if (backend == THEORY) {
+        if (!materialized.has_value()) materialized = materialize();
+        return materialized.value();
+    }
+    return value;
+}
+
+void
+MemoryObject::push_stored_terms(z3::expr_vector& terms) const {
+    auto& z3ctx = terms.ctx();
+    auto conditions = value.get_conditions();
+    auto expressions = value.get_expressions();
+    terms.push_back(z3ctx.int_val(static_cast<int>(backend)));
+    terms.push_back(z3ctx.int_val(static_cast<int>(conditions.size())));
+    for (const auto& c : conditions) terms.push_back(c);
+    for (const auto& e : expressions) terms.push_back(e);
+    if (array_value.has_value()) terms.push_back(array_value.value());
+}
+
+void
+MemoryObject::set_array_backend(ArrayBackend new_backend) {
+    if (new_backend == backend || !is_array() || indices.size() != sizes.size()) return;
+    if (new_backend == THEORY) {
+        // an opaque array under the stores, reads reaching it fall back to the piecewise value
+        auto& z3ctx = indices.ctx();
+        z3::sort_vector domain(z3ctx);
+        for (const auto& i : indices) domain.push_back(i.get_sort());
+        auto expressions = value.get_expressions();
+        auto range = expressions.size() > 0 ? expressions[0].get_sort() : z3ctx.int_sort();
+        array_value = z3ctx.constant((name + "_base").c_str(), z3ctx.array_sort(domain, range));
+    } else {
+        value = get_value();
+        array_value.reset();
+    }
+    materialized.reset();
+    backend = new_backend;
+    concrete_writes = 0;
+}
+
+// the condition that two indices are the same
+static z3::expr
+same_index(const z3::expr_vector& lhs, const z3::expr_vector& rhs) {
+    z3::expr_vector eqs(lhs.ctx());
+    for (unsigned i = 0; i < lhs.size(); ++i) {
+        eqs.push_back(lhs[i] == rhs[i]);
+    }
+    return z3::mk_and(eqs).simplify();
+}
+
+static z3::expr_vector
+get_store_index(const z3::expr& store) {
+    z3::expr_vector store_index(store.ctx());
+    for (unsigned i = 1; i + 1 < store.num_args(); ++i) {
+        store_index.push_back(store.arg(i));
+    }
+    return store_index;
+}
+
+z3::expr
+MemoryObject::read_store_chain(const z3::expr& array, const z3::expr_vector& index) const {
+    if (array.is_app() && array.decl().decl_kind() == Z3_OP_STORE) {
+        auto store_index = get_store_index(array);
+        auto stored = array.arg(array.num_args() - 1);
+        auto cmp = compare_indices(index, store_index);
+        if (cmp == 1) return stored;
+        auto rest = read_store_chain(array.arg(0), index);
+        if (cmp == -1) return rest;
+        return z3::ite(same_index(index, store_index), stored, rest);
+    }
+    // reached the base of the chain, which stands for the piecewise value
+    std::vector<Expression> index_exprs;
+    for (const auto& i : index) index_exprs.emplace_back(i);
+    return value.subs(indices, index_exprs).as_expr();
+}
+
+Expression
+MemoryObject::materialize() const {
+    auto& z3ctx = indices.ctx();
+    z3::expr_vector conditions(z3ctx);
+    z3::expr_vector expressions(z3ctx);
+    // stores from the latest to the earliest
+    std::vector<z3::expr_vector> written;
+    auto cur = array_value.value();
+    while (cur.is_app() && cur.decl().decl_kind() == Z3_OP_STORE) {
+        auto store_index = get_store_index(cur);
+        bool shadowed = false;
+        z3::expr_vector cond(z3ctx);
+        cond.push_back(same_index(indices, store_index));
+        for (const auto& later : written) {
+            auto cmp = compare_indices(store_index, later);
+            if (cmp == 1) {
+                shadowed = true;
+                break;
+            } else if (cmp == 0) {
+                cond.push_back(!same_index(indices, later));
+            }
+        }
+        if (!shadowed) {
+            conditions.push_back(z3::mk_and(cond).simplify());
+            expressions.push_back(cur.arg(cur.num_args() - 1));
+            written.push_back(store_index);
+        }
+        cur = cur.arg(0);
+    }
+    // the remaining part comes from the value before switching
+    z3::expr_vector untouched(z3ctx);
+    for (const auto& later : written) {
+        untouched.push_back(!same_index(indices, later));
+    }
+    auto base_conditions = value.get_conditions();
+    auto base_expressions = value.get_expressions();
+    for (unsigned i = 0; i < base_conditions.size(); ++i) {
+        untouched.push_back(base_conditions[i]);
+        conditions.push_back(z3::mk_and(untouched).simplify());
+        untouched.pop_back();
+        expressions.push_back(base_expressions[i]);
+    }
+    return Expression(conditions, expressions);
+}
 
 Expression
 MemoryObject::read(const std::vector<Expression>& index) const {
@@ -16,6 +171,11 @@ MemoryObject::read(const std::vector<Expression>& index) const {
         return read(zeros);
     }
     assert(index.size() == get_sizes().size() && "Index size does not match array dimensions");
+    if (backend == THEORY) {
+        z3::expr_vector z3_index(indices.ctx());
+        for (const auto& i : index) z3_index.push_back(i.as_expr());
+        return Expression(read_store_chain(array_value.value(), z3_index));
+    }
     return value.subs(indices, index);
 }
 
@@ -35,6 +195,11 @@ MemoryObject::read() const {
 
 void
 MemoryObject::write(const Expression& v) {
+    // the whole content is replaced, e.g., by a loop summary, so start over with a piecewise value
+    backend = PIECEWISE;
+    array_value.reset();
+    materialized.reset();
+    concrete_writes = 0;
     value = v;
 }
 
@@ -49,14 +214,125 @@ MemoryObject::write(const std::vector<Expression>& _index, const Expression& v)
     }
     assert(index.size() == get_sizes().size() && "Index size does not match array dimensions");
 
-    z3::expr new_condition = z3ctx.bool_val(true);
     z3::expr_vector z3_index(z3ctx);
     for (int i = 0; i < index.size(); i++) {
-        new_condition = new_condition && indices[i] == index[i].as_expr();
+        z3_index.push_back(index[i].as_expr());
+    }
+    if (backend == PIECEWISE && is_concrete_index(z3_index) && theory_threshold() > 0 &&
+        ++concrete_writes >= theory_threshold()) {
+        // many point updates, stop growing the piecewise value
+        set_array_backend(THEORY);
+    }
+    if (backend == THEORY) {
+        array_value = z3::store(array_value.value(), z3_index, v.as_expr());
+        materialized.reset();
+        return;
+    }
+
+    z3::expr new_condition = z3ctx.bool_val(true);
+    for (int i = 0; i < index.size(); i++) {
+        new_condition = new_condition && indices[i] == z3_index[i];
     }
     value.push_front(new_condition, v.as_expr());
 }
 
+// the position of the element at indices in the row-major layout of an array of the given sizes
+static z3::expr
+flatten_index(const z3::expr_vector& indices, const std::vector<Expression>& sizes) {
+    z3::expr flat = indices[0];
+    for (unsigned i = 1; i < indices.size(); ++i) {
+        flat = flat * sizes[i].as_expr() + indices[i];
+    }
+    return flat;
+}
+
+bool
+MemoryObject::copy_range(const MemoryObject& src, const Expression& src_start, const Expression& dst_start, const Expression& count) {
+    if (!is_array() || !src.is_array()) return false;
+    if (indices.size() != sizes.size() || src.indices.size() != src.sizes.size()) return false;
+    auto src_start_expr = src_start.as_expr();
+    auto dst_start_expr = dst_start.as_expr();
+
+    std::vector<Expression> src_index;
+    if (indices.size() == 1 && src.indices.size() == 1) {
+        src_index.emplace_back((indices[0] - dst_start_expr + src_start_expr).simplify());
+    } else {
+        if (indices.size() != src.indices.size()) return false;
+        for (unsigned i = 1; i < sizes.size(); ++i) {
+            if (!z3::eq(sizes[i].as_expr().simplify(), src.sizes[i].as_expr().simplify())) return false;
+        }
+        if (!z3::eq(src_start_expr.simplify(), dst_start_expr.simplify())) return false;
+        for (const auto& i : indices) src_index.emplace_back(i);
+    }
+
+    auto flat = flatten_index(indices, sizes);
+    auto in_range = (dst_start_expr <= flat && flat < dst_start_expr + count.as_expr()).simplify();
+    auto copied = src.read(src_index);
+
+    // the copied range replaces the old content, so the store chain is not needed anymore
+    set_array_backend(PIECEWISE);
+    auto copied_conditions = copied.get_conditions();
+    auto copied_expressions = copied.get_expressions();
+    for (int i = copied_conditions.size() - 1; i >= 0; --i) {
+        value.push_front((in_range && copied_conditions[i]).simplify(), copied_expressions[i]);
+    }
+    return true;
+}
+
+static bool
+same_address(const MemoryAddress_ty& lhs, const MemoryAddress_ty& rhs) {
+    if (lhs.loc != rhs.loc || lhs.offset.size() != rhs.offset.size()) return false;
+    if (!z3::eq(lhs.base.as_expr(), rhs.base.as_expr())) return false;
+    for (size_t i = 0; i < lhs.offset.size(); ++i) {
+        if (!z3::eq(lhs.offset[i].as_expr(), rhs.offset[i].as_expr())) return false;
+    }
+    return true;
+}
+
+bool
+MemoryObject::merge(const MemoryObject& other, const z3::expr& cond) {
+    if (is_pointer() || other.is_pointer()) {
+        return is_pointer() && other.is_pointer() && same_address(ptr_value.value(), other.ptr_value.value());
+    }
+    if (indices.size() != other.indices.size() || sizes.size() != other.sizes.size()) return false;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if (!z3::eq(sizes[i].as_expr(), other.sizes[i].as_expr())) return false;
+    }
+
+    auto lhs = get_value();
+    auto rhs = other.get_value();
+    bool same_indices = true;
+    for (unsigned i = 0; i < indices.size(); ++i) same_indices = same_indices && z3::eq(indices[i], other.indices[i]);
+    if (!same_indices) {
+        std::vector<Expression> index_exprs;
+        for (const auto& i : indices) index_exprs.emplace_back(i);
+        rhs = rhs.subs(other.indices, index_exprs);
+    }
+    if (z3::eq(lhs.as_expr(), rhs.as_expr())) return true;
+
+    auto& z3ctx = indices.ctx();
+    z3::expr_vector conditions(z3ctx);
+    z3::expr_vector expressions(z3ctx);
+    auto lhs_conditions = lhs.get_conditions();
+    auto lhs_expressions = lhs.get_expressions();
+    for (unsigned i = 0; i < lhs_conditions.size(); ++i) {
+        conditions.push_back(cond && lhs_conditions[i]);
+        expressions.push_back(lhs_expressions[i]);
+    }
+    auto rhs_conditions = rhs.get_conditions();
+    auto rhs_expressions = rhs.get_expressions();
+    for (unsigned i = 0; i < rhs_conditions.size(); ++i) {
+        conditions.push_back(!cond && rhs_conditions[i]);
+        expressions.push_back(rhs_expressions[i]);
+    }
+    value = Expression(conditions, expressions);
+    backend = PIECEWISE;
+    array_value.reset();
+    materialized.reset();
+    concrete_writes = 0;
+    return true;
+}
+
 z3::expr
 MemoryObject::get_signature() const {
     // For array, the signature is a function of form f(n1, n2, ..., nd);
@@ -78,6 +354,21 @@ MemoryObject::get_ptr_value() const {
     }
 }
 
+void
+MemoryObject::add_footprint(Footprint& fp) const {
+    fp.add(sizeof(MemoryObject) + name.capacity() + sizes.capacity() * sizeof(Expression));
+    fp.add(value);
+    if (array_value.has_value()) fp.add(array_value.value());
+    if (materialized.has_value()) fp.add(materialized.value());
+    if (ptr_value.has_value()) {
+        fp.add(ptr_value->base);
+        for (const auto& offset : ptr_value->offset) fp.add(offset);
+    }
+    fp.add(indices);
+    for (const auto& size : sizes) fp.add(size);
+    fp.add(constraints);
+}
+
 std::string
 MemoryObject::to_string() const {
     std::string result;
@@ -9,6 +9,7 @@
 #include "AnalysisManager.h"
 #include "logics.h"
 #include "Expr.h"
+#include "MemoryAccounting.h"
 
 namespace ari_exe {
     /**
@@ -44,7 +45,7 @@ namespace ari_exe {
                          const z3::expr_vector& indices,
                          const std::vector<Expression>& sizes,
                          const std::string& name,
-                         bool _is_signed = true): llvm_value(llvm_value), addr(obj_addr), value(value), ptr_value(ptr_value), indices(indices), sizes(sizes), name(name + std::to_string(name_counter[name])), _is_signed(_is_signed), constraints(indices.ctx()) {}
+                         bool _is_signed = true): llvm_value(llvm_value), addr(obj_addr), value(value), ptr_value(ptr_value), indices(indices), sizes(sizes), name(name + "0"), _is_signed(_is_signed), constraints(indices.ctx()) {}
 
             // read the first value of the memory object
             Expression read() const;
@@ -58,6 +59,24 @@ namespace ari_exe {
             // write the value at the given index in place
             void write(const std::vector<Expression>& index, const Expression& v);
 
+            /**
+             * @brief copy count elements of src, starting from the flattened position src_start,
+             *        to this array starting from dst_start, as a single case over indices.
+             * @details Multi-dimensional arrays are supported if both arrays have the same inner dimensions
+             *          and the copy does not shift elements, i.e., src_start and dst_start are the same.
+             * @return false if the copy is not supported, and nothing is written
+             */
+            bool copy_range(const MemoryObject& src, const Expression& src_start, const Expression& dst_start, const Expression& count);
+
+            /**
+             * @brief merge the content of other into this object, so that it is the content of this object
+             *        if cond holds and the content of other otherwise.
+             *        Arrays are merged as piecewise expressions.
+             * @return false if the objects cannot be merged, e.g., they have different shapes or
+             *         are pointers to different addresses, and nothing is changed
+             */
+            bool merge(const MemoryObject& other, const z3::expr& cond);
+
             // get sizes of the memory object
             std::vector<Expression> get_sizes() const { return sizes; }
 
@@ -73,7 +92,33 @@ namespace ari_exe {
 
             bool is_pointer() const { return ptr_value.has_value(); };
 
-            Expression get_value() const { return value; }
+            /**
+             * @brief the content of the object, arrays are given as piecewise expressions over indices
+             */
+            Expression get_value() const;
+
+            /**
+             * @brief push the terms the content is stored as, without building the piecewise value of
+             *        an array. z3 terms are hash-consed, so objects storing the same terms push the same asts.
+             */
+            void push_stored_terms(z3::expr_vector& terms) const;
+
+            /**
+             * @brief representations of the content of an array
+             *        PIECEWISE: value is a piecewise expression over indices, and each write prepends a case.
+             *        THEORY: the content is a z3 array, i.e., a chain of stores over the piecewise value
+             *                at the time of switching, so writes do not touch previous cases.
+             * @details An array switches to THEORY after enough writes at concrete indices,
+             *          and back to PIECEWISE when its whole content is overwritten.
+             */
+            enum ArrayBackend {
+                PIECEWISE,
+                THEORY,
+            };
+
+            ArrayBackend get_array_backend() const { return backend; }
+
+            void set_array_backend(ArrayBackend new_backend);
 
             MemoryAddress_ty get_ptr_value() const;
 
@@ -90,6 +135,11 @@ namespace ari_exe {
 
             std::string to_string() const;
 
+            /**
+             * @brief add the bytes held by this object to the footprint
+             */
+            void add_footprint(Footprint& fp) const;
+
             bool is_signed() const { return _is_signed; }
 
             void set_signed(bool is_signed) { _is_signed = is_signed; }
@@ -119,11 +169,34 @@ namespace ari_exe {
 
             bool _is_signed = true;
             // the name of this object, used for generate z3 function.
+            // It is the given name followed by 0, so that the function differs from the one named by the given name,
+            // which is the initial content of objects allocated in heap.
             std::string name;
 
-            static std::map<std::string, int> name_counter;
-            
             z3::expr constraints;
+
+            ArrayBackend backend = PIECEWISE;
+
+            // the z3 array of the content if backend is THEORY, i.e., stores over an opaque array constant
+            // which stands for value, the piecewise value at the time of switching
+            std::optional<z3::expr> array_value;
+
+            // the piecewise value of array_value, computed on demand and dropped on every write
+            mutable std::optional<Expression> materialized;
+
+            // number of writes at concrete indices while the backend is PIECEWISE
+            size_t concrete_writes = 0;
+
+            /**
+             * @brief read the array at index by walking the store chain,
+             *        stores at indices different from index are skipped
+             */
+            z3::expr read_store_chain(const z3::expr& array, const z3::expr_vector& index) const;
+
+            /**
+             * @brief convert the store chain into a piecewise expression over indices
+             */
+            Expression materialize() const;
     };
 }
 
@@ -0,0 +1,130 @@
+//----------------------------- NameService.h -----------------------------
+//
+// This file contains the service naming the z3 symbols created during the analysis.
+//
+//------------------------------------------------------------------------------------------//
+
+#ifndef NAMESERVICE_H
+#define NAMESERVICE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "z3++.h"
+#include "llvm/IR/Value.h"
+
+#include "common.h"
+
+namespace ari_exe {
+    /**
+     * @brief Names of the z3 symbols created for llvm values in one z3 context.
+     *        Each service belongs to exactly one context and is owned next to it,
+     *        e.g., AnalysisManager owns the service of the analysis context.
+     * @details The z3 name and the interned z3 symbol of a value are computed once per value,
+     *          and fresh names are numbered by integer ids per key. Ids are never reset when a
+     *          new module is loaded, so fresh names stay unique in the context across all tasks
+     *          sharing it; only the cached names, keyed by addresses a new module may reuse, are
+     *          dropped. All members are guarded by a mutex, so tasks on different threads may
+     *          share the service, as long as they serialize their own uses of the z3 context.
+     */
+    class NameService {
+        public:
+            explicit NameService(z3::context& ctx): ctx(ctx) {}
+            NameService(const NameService&) = delete;
+            NameService& operator=(const NameService&) = delete;
+
+            /**
+             * @brief the z3 name of the value, i.e., get_z3_name of its llvm name
+             */
+            std::string z3_name(const llvm::Value* value) {
+                std::lock_guard<std::mutex> guard(mutex);
+                return lookup(value).name;
+            }
+
+            /**
+             * @brief the interned z3 symbol of the z3 name of the value
+             */
+            z3::symbol symbol(const llvm::Value* value) {
+                std::lock_guard<std::mutex> guard(mutex);
+                return lookup(value).symbol;
+            }
+
+            /**
+             * @brief the integer constant named after the value
+             */
+            z3::expr int_const(const llvm::Value* value) { return ctx.constant(symbol(value), ctx.int_sort()); }
+
+            /**
+             * @brief the function from integers to integers named after the value, e.g., its recurrence in a loop
+             */
+            z3::func_decl int_function(const llvm::Value* value) {
+                auto int_sort = ctx.int_sort();
+                return ctx.function(symbol(value), 1, &int_sort, int_sort);
+            }
+
+            /**
+             * @brief the next id of the key, starting from 0
+             */
+            int next_id(const void* key) {
+                std::lock_guard<std::mutex> guard(mutex);
+                return ids[key]++;
+            }
+
+            /**
+             * @brief a fresh name for the value, i.e., its z3 name followed by tag and the next id of the value
+             */
+            std::string fresh_name(const llvm::Value* value, const char* tag) {
+                std::lock_guard<std::mutex> guard(mutex);
+                auto id = ids[value]++;
+                return lookup(value).name + tag + std::to_string(id);
+            }
+
+            /**
+             * @brief forget the cached names, e.g., when the values of the previous module are freed.
+             *        The ids are kept, so the names handed out afterwards never repeat earlier ones.
+             */
+            void forget_values() {
+                std::lock_guard<std::mutex> guard(mutex);
+                entries.clear();
+            }
+
+            /**
+             * @brief forget all ids and names
+             */
+            void reset() {
+                std::lock_guard<std::mutex> guard(mutex);
+                ids.clear();
+                entries.clear();
+            }
+
+        private:
+            struct Entry {
+                std::string name;
+                z3::symbol symbol;
+            };
+
+            // requires the mutex
+            const Entry& lookup(const llvm::Value* value) {
+                auto it = entries.find(value);
+                if (it == entries.end()) {
+                    auto name = get_z3_name(value->getName().str());
+                    auto symbol = ctx.str_symbol(name.c_str());
+                    it = entries.emplace(value, Entry{std::move(name), symbol}).first;
+                }
+                return it->second;
+            }
+
+            z3::context& ctx;
+
+            std::mutex mutex;
+
+            // the next id of each key
+            std::unordered_map<const void*, int> ids;
+
+            // the z3 name and symbol of each value
+            std::unordered_map<const llvm::Value*, Entry> entries;
+    };
+} // namespace ari_exe
+
+#endif
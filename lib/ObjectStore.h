@@ -0,0 +1,128 @@
+//----------------------------- ObjectStore.h -----------------------------
+//
+// This file contains a copy-on-write store of objects addressed by integer handles.
+//
+//------------------------------------------------------------------------------------------//
+
+#ifndef OBJECTSTORE_H
+#define OBJECTSTORE_H
+
+#include <cassert>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ari_exe {
+    /**
+     * @brief A store of objects addressed by their indices (handles).
+     * @details Every object lives in its own heap cell, so pointers to objects stay valid
+     *          when the store grows. Copying a store only copies the handles to the cells,
+     *          and the cells are shared between the copies until one of them accesses
+     *          an object mutably, at which point that object is cloned for the accessor.
+     *          Pointers obtained from a store should therefore not be used after the store is copied,
+     *          and read-only code should use peek, which never clones.
+     */
+    template<typename T>
+    class ObjectStore {
+        public:
+            ObjectStore() = default;
+            ObjectStore(const ObjectStore& other) = default;
+            ObjectStore& operator=(const ObjectStore& other) = default;
+
+            size_t size() const { return cells.size(); }
+
+            bool empty() const { return cells.empty(); }
+
+            /**
+             * @brief construct a new object at the end of the store
+             * @return the new object, whose handle is size() - 1
+             */
+            template<typename... Args>
+            T* emplace_back(Args&&... args) {
+                cells.push_back(std::make_shared<T>(std::forward<Args>(args)...));
+                return cells.back().get();
+            }
+
+            /**
+             * @brief add an object at the end of the store, moving it into the new cell
+             */
+            T* push_back(T&& object) {
+                cells.push_back(std::make_shared<T>(std::move(object)));
+                return cells.back().get();
+            }
+
+            void pop_back() {
+                assert(!cells.empty() && "Object store is empty");
+                cells.pop_back();
+            }
+
+            /**
+             * @brief remove the last object and return it,
+             *        the object is moved out unless it is shared with other stores
+             */
+            T take_back() {
+                assert(!cells.empty() && "Object store is empty");
+                auto cell = std::move(cells.back());
+                cells.pop_back();
+                if (cell.use_count() == 1) return std::move(*cell);
+                return *cell;
+            }
+
+            /**
+             * @brief get the object of the handle for reading and writing,
+             *        cloning it first if it is shared with other stores
+             */
+            T* get(size_t handle) {
+                assert(handle < cells.size() && "Invalid object handle");
+                auto& cell = cells[handle];
+                if (cell.use_count() > 1) {
+                    cell = std::make_shared<T>(*cell);
+                }
+                return cell.get();
+            }
+
+            /**
+             * @brief get the object of the handle for reading only, never clones
+             */
+            const T& peek(size_t handle) const {
+                assert(handle < cells.size() && "Invalid object handle");
+                return *cells[handle];
+            }
+
+            T* back() { return get(cells.size() - 1); }
+
+            const T& peek_back() const { return peek(cells.size() - 1); }
+
+            /**
+             * @brief the handle of the first object satisfying pred, or size() if none
+             */
+            template<typename Pred>
+            size_t find_if(Pred pred) const {
+                for (size_t i = 0; i < cells.size(); ++i) {
+                    if (pred(*cells[i])) return i;
+                }
+                return cells.size();
+            }
+
+            /**
+             * @brief merge the objects of other into the objects of this store at the same handles,
+             *        by merge_object(T& object, const T& other_object), which returns false if they cannot be merged.
+             *        Objects still shared by both stores are the same and are skipped.
+             * @return false if the stores differ in size or some objects cannot be merged
+             */
+            template<typename Merge>
+            bool merge(const ObjectStore& other, Merge merge_object) {
+                if (cells.size() != other.cells.size()) return false;
+                for (size_t i = 0; i < cells.size(); ++i) {
+                    if (cells[i] == other.cells[i]) continue;
+                    if (!merge_object(*get(i), *other.cells[i])) return false;
+                }
+                return true;
+            }
+
+        private:
+            std::vector<std::shared_ptr<T>> cells;
+    };
+} // namespace ari_exe
+
+#endif
@@ -1,24 +1,58 @@
 #include "cache.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <spdlog/spdlog.h>
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 
 Cache* Cache::instance = new Cache();
 
-std::optional<int> 
+Cache::Cache(): capacity(ari_exe::env_size("ARITHEXE_FUNC_CACHE_SIZE", 65536)) {}
+
+size_t
+Cache::KeyHash::operator()(const Key& key) const {
+    size_t res = std::hash<llvm::Function*>()(key.func);
+    for (auto& arg : key.args) {
+        res ^= std::hash<cache_int_ty>()(arg) + 0x9e3779b97f4a7c15ULL + (res << 6) + (res >> 2);
+    }
+    return res;
+}
+
+std::optional<param_list_ty>
 Cache::get_func_value(llvm::Function* func, const param_list_ty& args) {
-    auto it = cache.find(func);
-    if (it != cache.end()) {
-        auto& func_cache = it->second;
-        auto arg_it = func_cache.find(args);
-        if (arg_it != func_cache.end()) {
-            return arg_it->second;
-        }
+    import_loaded(func);
+    auto& func_counters = counters[func];
+    auto it = index.find(Key{func, args});
+    if (it == index.end()) {
+        func_counters.misses++;
+        return std::nullopt;
     }
-    return std::nullopt;
+    func_counters.hits++;
+    // move the entry to the front as it is the most recently used one
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
 }
 
 void
-Cache::cache_func_value(llvm::Function* func, const param_list_ty& args, int value) {
-    auto& func_cache = cache[func];
-    func_cache.insert_or_assign(args, value);
+Cache::cache_func_value(llvm::Function* func, const param_list_ty& args, const param_list_ty& value) {
+    if (capacity == 0) return;
+    import_loaded(func);
+    Key key{func, args};
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = value;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    entries.emplace_front(key, value);
+    index.emplace(std::move(key), entries.begin());
+    evict();
 }
 
 bool
@@ -29,4 +63,228 @@ Cache::is_visited(llvm::Function* func) const {
 void
 Cache::mark_visited(llvm::Function* func) {
     visited_funcs.insert(func);
-}
\ No newline at end of file
+}
+
+std::optional<cache_int_ty>
+Cache::from_numeral(const z3::expr& e) {
+    if (!e.is_int() || !e.is_numeral()) return std::nullopt;
+    int64_t value;
+    if (e.is_numeral_i64(value)) return value;
+    return e.get_decimal_string(0);
+}
+
+z3::expr
+Cache::to_numeral(z3::context& z3ctx, const cache_int_ty& value) {
+    if (auto small = std::get_if<int64_t>(&value)) return z3ctx.int_val(*small);
+    return z3ctx.int_val(std::get<std::string>(value).c_str());
+}
+
+void
+Cache::evict() {
+    while (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+void
+Cache::set_capacity(size_t new_capacity) {
+    capacity = new_capacity;
+    evict();
+}
+
+void
+Cache::clear() {
+    index.clear();
+    entries.clear();
+    counters.clear();
+    loaded.clear();
+    imported_funcs.clear();
+    visited_funcs.clear();
+}
+
+size_t
+Cache::get_hits(llvm::Function* func) const {
+    auto it = counters.find(func);
+    return it == counters.end() ? 0 : it->second.hits;
+}
+
+size_t
+Cache::get_misses(llvm::Function* func) const {
+    auto it = counters.find(func);
+    return it == counters.end() ? 0 : it->second.misses;
+}
+
+std::string
+Cache::to_string() const {
+    std::string res = "Function cache (" + std::to_string(entries.size()) + "/" + std::to_string(capacity) + " entries):";
+    for (auto& [func, func_counters] : counters) {
+        auto total = func_counters.hits + func_counters.misses;
+        auto rate = total == 0 ? 0.0 : 100.0 * func_counters.hits / total;
+        res += " " + func->getName().str() + " " + std::to_string(func_counters.hits) + "/" + std::to_string(total) +
+               " hits (" + std::to_string(static_cast<int>(rate)) + "%);";
+    }
+    return res;
+}
+
+std::optional<std::string>
+Cache::get_persistence_file() {
+    auto path = ari_exe::env_string("ARITHEXE_FUNC_CACHE_FILE");
+    if (path.empty()) return std::nullopt;
+    return path;
+}
+
+// the functions and global variables a constant refers to, e.g., through constant expressions
+static void
+collect_referenced(const llvm::Value* value, std::vector<const llvm::Function*>& funcs,
+                   std::vector<const llvm::GlobalVariable*>& globals, std::set<const llvm::Value*>& visited) {
+    auto constant = llvm::dyn_cast<llvm::Constant>(value);
+    if (constant == nullptr || !visited.insert(constant).second) return;
+    if (auto func = llvm::dyn_cast<llvm::Function>(constant)) {
+        funcs.push_back(func);
+        return;
+    }
+    if (auto global = llvm::dyn_cast<llvm::GlobalVariable>(constant)) {
+        globals.push_back(global);
+        if (global->hasInitializer()) collect_referenced(global->getInitializer(), funcs, globals, visited);
+        return;
+    }
+    for (auto& op : constant->operands()) collect_referenced(op.get(), funcs, globals, visited);
+}
+
+std::string
+Cache::persistent_name(const llvm::Function* func) {
+    // the results of a call also depend on its transitive callees and the globals they read,
+    // so all of them are printed in the order they are reached
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    std::vector<const llvm::Function*> funcs{func};
+    std::vector<const llvm::GlobalVariable*> globals;
+    std::set<const llvm::Value*> visited{func};
+    for (size_t i = 0; i < funcs.size(); i++) {
+        funcs[i]->print(os);
+        for (auto& block : *funcs[i]) {
+            for (auto& inst : block) {
+                for (auto& op : inst.operands()) collect_referenced(op.get(), funcs, globals, visited);
+            }
+        }
+    }
+    for (auto global : globals) global->print(os);
+    os.flush();
+    std::stringstream res;
+    res << func->getName().str() << "#" << std::hex << llvm::xxHash64(text);
+    return res.str();
+}
+
+void
+Cache::import_loaded(llvm::Function* func) {
+    if (loaded.empty() || !imported_funcs.insert(func).second) return;
+    auto it = loaded.find(persistent_name(func));
+    if (it == loaded.end()) return;
+    auto func_entries = std::move(it->second);
+    loaded.erase(it);
+    for (auto& [args, value] : func_entries) {
+        if (index.find(Key{func, args}) == index.end()) {
+            cache_func_value(func, args, value);
+        }
+    }
+}
+
+// a line of the file is: name#fingerprint, the number of arguments, the arguments,
+// the number of result integers and the result integers, separated by spaces
+static bool
+read_ints(std::istringstream& line, param_list_ty& ints) {
+    size_t count;
+    if (!(line >> count)) return false;
+    for (size_t i = 0; i < count; i++) {
+        std::string token;
+        if (!(line >> token)) return false;
+        size_t digits = token[0] == '-' ? 1 : 0;
+        if (digits == token.size() || !std::all_of(token.begin() + digits, token.end(), [](unsigned char c) { return std::isdigit(c); })) return false;
+        try {
+            ints.push_back(static_cast<int64_t>(std::stoll(token)));
+        } catch (const std::out_of_range&) {
+            ints.push_back(token);
+        }
+    }
+    return true;
+}
+
+static void
+write_ints(std::ostream& os, const param_list_ty& ints) {
+    os << " " << ints.size();
+    for (auto& value : ints) {
+        if (auto small = std::get_if<int64_t>(&value)) {
+            os << " " << *small;
+        } else {
+            os << " " << std::get<std::string>(value);
+        }
+    }
+}
+
+bool
+Cache::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string raw_line;
+    size_t count = 0;
+    while (std::getline(file, raw_line)) {
+        std::istringstream line(raw_line);
+        std::string name;
+        param_list_ty args, value;
+        if (!(line >> name) || !read_ints(line, args) || !read_ints(line, value)) {
+            spdlog::warn("Skipping malformed line of the function cache file {}: {}", path, raw_line);
+            continue;
+        }
+        loaded[name].emplace_back(std::move(args), std::move(value));
+        count++;
+    }
+    spdlog::info("Loaded {} function cache entries from {}", count, path);
+    return true;
+}
+
+bool
+Cache::save(const std::string& path, const llvm::Module& module) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    std::map<const llvm::Function*, std::string> names;
+    auto name_of = [&](const llvm::Function* func) -> const std::string& {
+        auto it = names.find(func);
+        if (it == names.end()) it = names.emplace(func, persistent_name(func)).first;
+        return it->second;
+    };
+
+    // the loaded entries not used yet are kept only for functions of the module with the same fingerprint,
+    // others were written for other programs or for older versions of the functions
+    std::set<std::string> current_names;
+    for (auto& func : module) {
+        if (!func.isDeclaration()) current_names.insert(name_of(&func));
+    }
+
+    // the most recently used entries first, the loaded ones were used before all of them
+    using saved_entry = std::tuple<const std::string*, const param_list_ty*, const param_list_ty*>;
+    std::vector<saved_entry> saved;
+    for (auto& [key, value] : entries) {
+        if (saved.size() >= capacity) break;
+        auto& name = name_of(key.func);
+        // names are separated by spaces in the file
+        if (name.find_first_of(" \t") != std::string::npos) continue;
+        saved.emplace_back(&name, &key.args, &value);
+    }
+    for (auto& [name, func_entries] : loaded) {
+        if (!current_names.count(name)) continue;
+        for (auto it = func_entries.rbegin(); it != func_entries.rend() && saved.size() < capacity; ++it) {
+            saved.emplace_back(&name, &it->first, &it->second);
+        }
+    }
+
+    // the least recently used entries first, so that loading them keeps the order of use
+    for (auto it = saved.rbegin(); it != saved.rend(); ++it) {
+        auto [name, args, value] = *it;
+        file << *name;
+        write_ints(file, *args);
+        write_ints(file, *value);
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
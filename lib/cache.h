@@ -3,13 +3,35 @@
 
 #include <set>
 #include <map>
+#include <list>
 #include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
 #include "z3++.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 
-using param_list_ty = std::vector<int>;
-// currently, assume both return values and arguments are integers
-using function_cached_ty = std::map<param_list_ty, int>;
+// an integer of arguments or results, big integers are kept as their decimal numerals
+using cache_int_ty = std::variant<int64_t, std::string>;
+// the arguments of a call, or the result of a call, whose fields and elements
+// are flattened in order if it is a struct or an array without pointers
+using param_list_ty = llvm::SmallVector<cache_int_ty, 4>;
+
+/**
+ * @brief A bounded memo table of the results of calls with concrete arguments.
+ *        It is implemented in singleton pattern.
+ * @details Entries are keyed by (function, arguments) in a hash table. The least recently used
+ *          entry is evicted when the table holds more than ARITHEXE_FUNC_CACHE_SIZE entries,
+ *          65536 by default. Hits and misses are counted per function.
+ *          If ARITHEXE_FUNC_CACHE_FILE is set, the entries are loaded from the file when
+ *          the verification starts and saved to it when the verification ends.
+ *          Functions are identified in the file by their names and a fingerprint of their bodies,
+ *          the bodies of their transitive callees and the globals they refer to, with initializers.
+ *          Entries are not loaded once any of them changes, but changes the printed IR does not show,
+ *          e.g., in the options of the verifier, are not detected.
+ */
 class Cache {
     public:
         ~Cache() = default;
@@ -19,18 +41,105 @@ class Cache {
         Cache& operator=(Cache&&) = delete;
         static Cache* get_instance() { return instance; }
 
-        std::optional<int> get_func_value(llvm::Function* func, const param_list_ty& args);
+        std::optional<param_list_ty> get_func_value(llvm::Function* func, const param_list_ty& args);
 
-        void cache_func_value(llvm::Function* func, const param_list_ty& args, int value);
+        void cache_func_value(llvm::Function* func, const param_list_ty& args, const param_list_ty& value);
 
         bool is_visited(llvm::Function* func) const;
 
         void mark_visited(llvm::Function* func);
 
+        /**
+         * @brief the integer of an integer numeral, nullopt for other expressions
+         */
+        static std::optional<cache_int_ty> from_numeral(const z3::expr& e);
+
+        static z3::expr to_numeral(z3::context& z3ctx, const cache_int_ty& value);
+
+        /**
+         * @brief drop all entries, the visited functions and the counters,
+         *        needed before functions of another module are cached
+         */
+        void clear();
+
+        /**
+         * @brief set the maximal number of entries, 0 disables the cache
+         */
+        void set_capacity(size_t new_capacity);
+
+        size_t size() const { return entries.size(); }
+        size_t get_hits(llvm::Function* func) const;
+        size_t get_misses(llvm::Function* func) const;
+
+        /**
+         * @brief hit-rate counters of the functions in a human readable form
+         */
+        std::string to_string() const;
+
+        /**
+         * @brief the file given by ARITHEXE_FUNC_CACHE_FILE, if any
+         */
+        static std::optional<std::string> get_persistence_file();
+
+        /**
+         * @brief read the entries of a file written by save, which are added to the functions
+         *        of the same name and fingerprint when they are first looked up
+         * @return false if the file cannot be read
+         */
+        bool load(const std::string& path);
+
+        /**
+         * @brief write the entries to the file, together with the loaded entries not used yet
+         *        of the functions of module, at most as many entries as the capacity,
+         *        dropping the least recently used ones
+         * @return false if the file cannot be written
+         */
+        bool save(const std::string& path, const llvm::Module& module);
+
     private:
-        Cache() = default;
+        Cache();
+
+        struct Key {
+            llvm::Function* func;
+            param_list_ty args;
+
+            bool operator==(const Key& other) const { return func == other.func && args == other.args; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const;
+        };
+
+        struct Counters {
+            size_t hits = 0;
+            size_t misses = 0;
+        };
+
+        using entry_list = std::list<std::pair<Key, param_list_ty>>;
+
+        // the name and the fingerprint of the function, its transitive callees and the globals they
+        // refer to, which identify a function in a file
+        static std::string persistent_name(const llvm::Function* func);
+
+        // move the loaded entries of the function into the table
+        void import_loaded(llvm::Function* func);
+
+        void evict();
+
+        // entries in the order of use, the most recently used one comes first
+        entry_list entries;
+
+        std::unordered_map<Key, entry_list::iterator, KeyHash> index;
+
+        size_t capacity;
+
+        std::map<llvm::Function*, Counters> counters;
+
+        // entries read from a file, by the persistent names of their functions
+        std::map<std::string, std::vector<std::pair<param_list_ty, param_list_ty>>> loaded;
 
-        std::map<llvm::Function*, function_cached_ty> cache;
+        // functions whose loaded entries have been imported
+        std::set<llvm::Function*> imported_funcs;
 
         static Cache* instance;
 
@@ -38,4 +147,4 @@ class Cache {
         std::set<llvm::Function*> visited_funcs;
 };
 
-#endif
\ No newline at end of file
+#endif
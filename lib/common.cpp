@@ -1,5 +1,9 @@
 #include "common.h"
 
+#include <cctype>
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+
 namespace ari_exe {
     z3::expr_vector get_app_of(z3::expr e, z3::func_decl f) {
         z3::expr_vector result(e.ctx());
@@ -92,4 +96,47 @@ namespace ari_exe {
         }
         return result;
     }
-}
\ No newline at end of file
+
+    bool
+    env_flag(const char* name, bool default_value) {
+        auto value = env_string(name);
+        if (value.empty()) return default_value;
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+        return value != "0" && value != "false" && value != "no" && value != "off";
+    }
+
+    int
+    env_int(const char* name, int default_value) {
+        auto value = env_string(name);
+        if (value.empty()) return default_value;
+        try {
+            size_t parsed = 0;
+            auto res = std::stoi(value, &parsed);
+            if (parsed == value.size()) return res;
+        } catch (...) {}
+        spdlog::warn("Invalid {}={}, using {}", name, value, default_value);
+        return default_value;
+    }
+
+    size_t
+    env_size(const char* name, size_t default_value) {
+        auto value = env_string(name);
+        if (value.empty()) return default_value;
+        // stoul would wrap negative values around
+        if (std::isdigit(static_cast<unsigned char>(value[0]))) {
+            try {
+                size_t parsed = 0;
+                auto res = std::stoul(value, &parsed);
+                if (parsed == value.size()) return res;
+            } catch (...) {}
+        }
+        spdlog::warn("Invalid {}={}, using {}", name, value, default_value);
+        return default_value;
+    }
+
+    std::string
+    env_string(const char* name) {
+        const char* raw = std::getenv(name);
+        return raw == nullptr ? "" : raw;
+    }
+}
@@ -81,6 +81,7 @@ namespace ari_exe {
         OverApproximation,
         IncompleteCounterexample,
         UnknownState,
+        UnrollBound,
     };
 
     inline const char* to_string(VerifierIssueKind kind) {
@@ -101,6 +102,8 @@ namespace ari_exe {
                 return "incomplete-counterexample";
             case VerifierIssueKind::UnknownState:
                 return "unknown-state";
+            case VerifierIssueKind::UnrollBound:
+                return "unroll-bound";
         }
         return "unknown";
     }
@@ -159,6 +162,29 @@ namespace ari_exe {
      *        It is not a set, so elements may repeat.
      */
     std::vector<z3::expr> get_func_apps(z3::expr e);
+
+    /**
+     * @brief read a flag from the environment, default_value if it is unset or empty,
+     *        false for 0, false, no and off in any case, and true otherwise
+     */
+    bool env_flag(const char* name, bool default_value = false);
+
+    /**
+     * @brief read an integer from the environment, default_value if it is unset or empty,
+     *        or with a warning if it is not an integer
+     */
+    int env_int(const char* name, int default_value);
+
+    /**
+     * @brief read a size from the environment, default_value if it is unset or empty,
+     *        or with a warning if it is not a non-negative integer
+     */
+    size_t env_size(const char* name, size_t default_value);
+
+    /**
+     * @brief read a string from the environment, empty if it is unset
+     */
+    std::string env_string(const char* name);
 }
 
 #endif
@@ -1,8 +1,11 @@
 #include "engine.h"
+#include "logics.h"
 
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <optional>
 
 #include <spdlog/spdlog.h>
 
@@ -25,6 +28,11 @@ Engine::verify() {
     counterexample_inputs.clear();
     loop_certificates.clear();
     function_certificates.clear();
+    LoopInduction::start_budget();
+    auto cache_file = Cache::get_persistence_file();
+    if (cache_file.has_value() && !Cache::get_instance()->load(*cache_file)) {
+        spdlog::info("No function cache loaded from {}", *cache_file);
+    }
     run();
     auto res = VERIUNKNOWN;
     if (std::all_of(results.begin(), results.end(), [](VeriResult veri_res) { return veri_res == HOLD; })) {
@@ -32,6 +40,15 @@ Engine::verify() {
     } else if (std::any_of(results.begin(), results.end(), [](VeriResult veri_res) { return veri_res == FAIL; })) {
         res = FAIL;
     }
+    spdlog::debug("{}", SimplifyCache::get_instance()->to_string());
+    spdlog::debug("{}", SolverPool::get_instance().to_string());
+    spdlog::debug("{}", Cache::get_instance()->to_string());
+    if (cache_file.has_value() && !Cache::get_instance()->save(*cache_file, *get_module())) {
+        spdlog::warn("Cannot write the function cache to {}", *cache_file);
+    }
+    if (MemoryAccounting::get_instance()->is_enabled()) {
+        spdlog::info("{}", MemoryAccounting::get_instance()->to_string());
+    }
     return res;
 }
 
@@ -51,10 +68,12 @@ Engine::run(state_ptr state) {
     // set the default entry point if not set
     set_default_entry();
 
+    MemoryAccounting::Phase phase("engine");
     states.push(state);
     while (!states.empty()) {
         auto cur_state = states.top();
         states.pop();
+        MemoryAccounting::get_instance()->sample(*cur_state);
         spdlog::debug("Current Instruction: {}", cur_state->pc->inst->getName().str());
         // llvm::errs() << *cur_state->pc->inst << "\n";
         // llvm::errs() << cur_state->memory.to_string() << "\n";
@@ -110,6 +129,12 @@ Engine::run(state_ptr state) {
             }
             // TODO: what to do with unknown path?
             continue;
+        } else if (cur_state->status == State::BOUNDED) {
+            // other paths may still fail, so the verification goes on
+            record_issue(VerifierIssueKind::UnrollBound,
+                         "a loop is unrolled to the bound and cannot be proved by k-induction");
+            results.push_back(VERIUNKNOWN);
+            continue;
         } else if (cur_state->status == State::UNKNOWN) {
             // if the state is unknown, we should not continue
             record_issue(VerifierIssueKind::UnknownState,
@@ -158,6 +183,8 @@ Engine::run() {
     llvm::errs() << "Running the engine...\n";
     set_default_entry();
     llvm::errs() << "Entry point: " << entry->getName() << "\n";
+    // recursive functions are summarized before the execution, so that it never waits for them
+    FunctionSummarizer::summarize_bottom_up(entry, z3ctx);
     state_ptr initial_state = build_initial_state();
     llvm::errs() << "Initial Instruction: " << *initial_state->pc->inst << "\n";
     return run(initial_state);
@@ -210,10 +237,30 @@ Engine::capture_counterexample(state_ptr state, const z3::model& model) {
             z3::expr evaluated_count = model.eval(*call.count, true).simplify();
             int64_t count = 0;
             if (!evaluated_count.is_numeral_i64(count) || count < 0) continue;
+            // read the interpretation of the values once, instead of evaluating them index by index
+            std::map<int64_t, z3::expr> entries;
+            std::optional<z3::expr> else_value;
+            if (model.has_interp(*call.values)) {
+                z3::func_interp interp = model.get_func_interp(*call.values);
+                for (unsigned i = 0; i < interp.num_entries(); ++i) {
+                    z3::func_entry entry = interp.entry(i);
+                    int64_t argument = 0;
+                    if (entry.num_args() == 1 && entry.arg(0).is_numeral_i64(argument)) {
+                        entries.insert({argument, entry.value()});
+                    }
+                }
+                if (interp.else_value().is_numeral()) else_value = interp.else_value();
+            }
             for (int64_t index = 0; index < count; ++index) {
-                z3::expr argument = z3ctx.int_val(std::to_string(index).c_str());
-                values.push_back(
-                    model.eval((*call.values)(argument), true).simplify());
+                if (auto it = entries.find(index); it != entries.end()) {
+                    values.push_back(it->second);
+                } else if (else_value.has_value()) {
+                    values.push_back(*else_value);
+                } else {
+                    z3::expr argument = z3ctx.int_val(std::to_string(index).c_str());
+                    values.push_back(
+                        model.eval((*call.values)(argument), true).simplify());
+                }
             }
         }
 
@@ -1,4 +1,5 @@
 #include "logics.h"
+#include "common.h"
 
 
 #include "z3++.h"
@@ -8,22 +9,172 @@
 #include <spdlog/spdlog.h>
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
 
 namespace ari_exe {
 
+    SimplifyCache* SimplifyCache::instance = new SimplifyCache();
+
+    SimplifyCache::SimplifyCache(): capacity(env_size("ARITHEXE_SIMPLIFY_CACHE_SIZE", 4096)) {}
+
+    SimplifyCache::key_ty
+    SimplifyCache::make_key(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption) {
+        // shift the assumption id by one so that "no assumption" gets its own slot
+        unsigned assumption_id = assumption.has_value() ? assumption->id() + 1 : 0;
+        return {kind, input.id(), assumption_id};
+    }
+
+    std::optional<z3::expr>
+    SimplifyCache::lookup(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption) {
+        if (!is_cacheable(input)) return std::nullopt;
+        auto it = index.find(make_key(kind, input, assumption));
+        if (it == index.end()) {
+            misses[kind]++;
+            return std::nullopt;
+        }
+        hits[kind]++;
+        // move the entry to the front as it is the most recently used one
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second.result;
+    }
+
+    void
+    SimplifyCache::insert(Kind kind, const z3::expr& input, const std::optional<z3::expr>& assumption, const z3::expr& result) {
+        if (capacity == 0 || !is_cacheable(input)) return;
+        auto key = make_key(kind, input, assumption);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second.result = result;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(key, Entry{input, assumption, result});
+        index.insert_or_assign(key, entries.begin());
+        evict();
+    }
+
+    bool
+    SimplifyCache::is_cacheable(const z3::expr& input) {
+        return &input.ctx() == &AnalysisManager::get_ctx();
+    }
+
+    void
+    SimplifyCache::evict() {
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    void
+    SimplifyCache::set_capacity(size_t new_capacity) {
+        capacity = new_capacity;
+        evict();
+    }
+
+    void
+    SimplifyCache::clear() {
+        index.clear();
+        entries.clear();
+        std::fill(std::begin(hits), std::end(hits), 0);
+        std::fill(std::begin(misses), std::end(misses), 0);
+    }
+
+    std::string
+    SimplifyCache::to_string() const {
+        static const char* names[NUM_KINDS] = {"simplify", "Logic::simplify", "eliminate_ite"};
+        std::string res = "SimplifyCache (" + std::to_string(entries.size()) + "/" + std::to_string(capacity) + " entries):";
+        for (int kind = 0; kind < NUM_KINDS; ++kind) {
+            auto total = hits[kind] + misses[kind];
+            auto rate = total == 0 ? 0.0 : 100.0 * hits[kind] / total;
+            res += std::string(" ") + names[kind] + " " + std::to_string(hits[kind]) + "/" + std::to_string(total) +
+                   " hits (" + std::to_string(static_cast<int>(rate)) + "%);";
+        }
+        return res;
+    }
+
+    SolverPool&
+    SolverPool::get_instance() {
+        static thread_local SolverPool pool;
+        return pool;
+    }
+
+    std::unique_ptr<z3::solver>
+    SolverPool::acquire(z3::context& z3ctx, bool& pooled) {
+        pooled = &z3ctx == &AnalysisManager::get_ctx();
+        if (!pooled) {
+            constructed++;
+            return std::make_unique<z3::solver>(z3ctx);
+        }
+        std::unique_ptr<z3::solver> solver;
+        if (idle.empty()) {
+            constructed++;
+            solver = std::make_unique<z3::solver>(z3ctx);
+        } else {
+            solver = std::move(idle.back());
+            idle.pop_back();
+            reused++;
+        }
+        // the assertions of the lease live in a scope popped by release
+        solver->push();
+        return solver;
+    }
+
+    void
+    SolverPool::release(std::unique_ptr<z3::solver> solver) {
+        // back to the base level, which drops the assertions of the lease together with unbalanced push,
+        // but keeps the internal state of the solver
+        solver->pop(Z3_solver_get_num_scopes(solver->ctx(), *solver));
+        idle.push_back(std::move(solver));
+    }
+
+    void
+    SolverPool::clear() {
+        idle.clear();
+        constructed = 0;
+        reused = 0;
+    }
+
+    std::string
+    SolverPool::to_string() const {
+        return "SolverPool: " + std::to_string(constructed) + " solvers constructed, " +
+               std::to_string(reused) + " leases served by idle solvers, " +
+               std::to_string(idle.size()) + " idle";
+    }
+
+    SolverPool::Lease::Lease(z3::context& z3ctx) {
+        solver = SolverPool::get_instance().acquire(z3ctx, pooled);
+    }
+
+    SolverPool::Lease::~Lease() {
+        if (pooled) {
+            SolverPool::get_instance().release(std::move(solver));
+        }
+    }
+
     z3::expr
     simplify(const z3::expr& expr, std::optional<z3::expr> assumption) {
+        auto cache = SimplifyCache::get_instance();
+        if (auto cached = cache->lookup(SimplifyCache::CONTEXTUAL, expr, assumption)) {
+            return *cached;
+        }
         auto logic = Logic();
         auto new_expr = expr.simplify();
         auto clauses= logic.to_cnf(new_expr);
+        if (logic.is_truncated()) {
+            // dropping clauses would weaken the expression
+            cache->insert(SimplifyCache::CONTEXTUAL, expr, assumption, new_expr);
+            return new_expr;
+        }
         auto& z3ctx = expr.ctx();
-        auto solver = z3::solver(z3ctx);
+        SolverPool::Lease lease(z3ctx);
+        auto& solver = *lease;
         if (assumption.has_value()) {
             solver.add(assumption.value());
         }
         z3::expr_vector remains(z3ctx);
         for (const auto& clause : clauses) {
-            solver.push();
+            SolverPool::Scope scope(solver);
             solver.add(!clause);
             if (solver.check() == z3::sat) {
                 // this clause is not entailed, so keep it
@@ -43,18 +194,18 @@ namespace ari_exe {
                 auto new_clause = z3::mk_or(minimized_literals);
                 remains.push_back(new_clause);
             }
-            solver.pop();
         }
-        return z3::mk_and(remains);
+        auto res = z3::mk_and(remains);
+        cache->insert(SimplifyCache::CONTEXTUAL, expr, assumption, res);
+        return res;
     }
 
     bool
     implies(const z3::expr& a, const z3::expr& b) {
-        auto& z3ctx = a.ctx();
-        z3::solver s(z3ctx);
-        s.add(a);
-        s.add(!b);
-        return s.check() == z3::unsat;
+        SolverPool::Lease s(a.ctx());
+        s->add(a);
+        s->add(!b);
+        return s->check() == z3::unsat;
     }
 
     /**
@@ -119,39 +270,37 @@ namespace ari_exe {
     z3::expr
     restrict_to_domain(const z3::expr& f, z3::expr domain) {
         auto [conditions, expressions] = expr2piecewise(f);
-        auto solver = z3::solver(f.ctx());
+        SolverPool::Lease lease(f.ctx());
+        auto& solver = *lease;
         solver.add(domain);
         auto feasible_conditions = z3::expr_vector(f.ctx());
         auto feasible_expressions = z3::expr_vector(f.ctx());
         for (int i = 0; i < conditions.size(); ++i) {
             // auto restricted_conditions = simplify(conditions[i] && domain);
             auto restricted_conditions = simplify(conditions[i], domain);
-            solver.push();
+            SolverPool::Scope scope(solver);
             solver.add(restricted_conditions);
             if (solver.check() == z3::sat) {
                 feasible_conditions.push_back(restricted_conditions);
                 feasible_expressions.push_back(expressions[i]);
             }
-            solver.pop();
         }
         return piecewise2ite(feasible_conditions, feasible_expressions);
     }
 
     bool is_feasible(const z3::expr& fml, std::optional<z3::expr> assumption) {
-        auto& z3ctx = fml.ctx();
-        z3::solver s(z3ctx);
+        SolverPool::Lease s(fml.ctx());
         if (assumption.has_value()) {
-            s.add(assumption.value());
+            s->add(assumption.value());
         }
-        s.add(fml);
-        return s.check() == z3::sat;
+        s->add(fml);
+        return s->check() == z3::sat;
     }
 
     bool is_equivalent(const z3::expr& f1, const z3::expr& f2) {
-        auto& z3ctx = f1.ctx();
-        z3::solver s(z3ctx);
-        s.add(f1 != f2);
-        return s.check() == z3::unsat;
+        SolverPool::Lease s(f1.ctx());
+        s->add(f1 != f2);
+        return s->check() == z3::unsat;
     }
 
     static void
@@ -209,6 +358,10 @@ namespace ari_exe {
 
     z3::expr
     eliminate_ite(const z3::expr& expr) {
+        auto cache = SimplifyCache::get_instance();
+        if (auto cached = cache->lookup(SimplifyCache::ELIM_ITE, expr)) {
+            return *cached;
+        }
         auto goal = z3::goal(expr.ctx());
         goal.add(expr);
         z3::expr_vector to_or(expr.ctx());
@@ -234,7 +387,9 @@ namespace ari_exe {
             eliminated_expr = z3::mk_or(qe_conditions).simplify();
             assert(is_equivalent(eliminated_expr, expr));
         }
-        return eliminated_expr.simplify();
+        auto res = eliminated_expr.simplify();
+        cache->insert(SimplifyCache::ELIM_ITE, expr, std::nullopt, res);
+        return res;
     }
 
     z3::expr
@@ -333,13 +488,15 @@ namespace ari_exe {
         auto& z3ctx = constraints.ctx();
         auto [processed_cons, tmp_vars] = preprocess_constraints(constraints);
 
-        z3::solver tmp_s(z3ctx);
-        tmp_s.add(processed_cons);
-        z3::solver tmp_s2(z3ctx);
-        tmp_s2.add(constraints);
+        SolverPool::Lease tmp_s(z3ctx);
+        tmp_s->add(processed_cons);
         auto dnf = to_dnf(processed_cons);
         spdlog::debug("DNF size: {}", dnf.size());
-        if (tmp_s.check() == z3::unsat || dnf.size() == 0) {
+        if (is_truncated()) {
+            spdlog::warn("DNF of the constraints exceeds {} cubes, give up solving", get_clause_limit());
+            return z3::expr_vector(z3ctx);
+        }
+        if (tmp_s->check() == z3::unsat || dnf.size() == 0) {
             return z3::expr_vector(z3ctx);
         }
 
@@ -481,15 +638,21 @@ namespace ari_exe {
         if (pivot >= conjunction.size()) {
             return conjunction; // nothing to minimize
         }
-        auto solver = z3::solver(conjunction.ctx());
         auto& ctx = conjunction.ctx();
-        solver.add(solver.ctx().bool_val(true)); // add a trivial constraint to avoid empty solver
-        solver.add(assumption.value());
         z3::expr pivot_expr = conjunction[pivot];
         auto remaining_exprs = get_expr_vec_except(conjunction, pivot);
-        solver.add(remaining_exprs);
-        solver.add(!pivot_expr);
-        if (solver.check() == z3::unsat) {
+        bool entailed;
+        {
+            // return the solver before recursing
+            SolverPool::Lease lease(ctx);
+            auto& solver = *lease;
+            solver.add(ctx.bool_val(true)); // add a trivial constraint to avoid empty solver
+            solver.add(assumption.value());
+            solver.add(remaining_exprs);
+            solver.add(!pivot_expr);
+            entailed = solver.check() == z3::unsat;
+        }
+        if (entailed) {
             // the pivot is entailed, so we can remove it
             return minimize_conjunction(remaining_exprs, pivot, assumption);
         } else {
@@ -517,21 +680,45 @@ namespace ari_exe {
         return z3::mk_or(not_core);
     }
 
-    z3::expr_vector
-    Logic::to_cnf(const z3::expr& fml) {
+    Logic::Logic(): clause_limit(env_size("ARITHEXE_NORMAL_FORM_LIMIT", 512)) {}
+
+    Logic::Logic(size_t clause_limit): clause_limit(clause_limit) {}
+
+    bool
+    Logic::for_each_cnf_clause(const z3::expr& fml, const std::function<bool(const z3::expr&)>& visit) {
         z3::context& ctx = fml.ctx();
-        z3::expr_vector cnf_clauses(ctx);
         auto atms = atoms(fml);
-        z3::solver s(ctx);
-        z3::solver snot(ctx);
+        SolverPool::Lease s_lease(ctx);
+        SolverPool::Lease snot_lease(ctx);
+        auto& s = *s_lease;
+        auto& snot = *snot_lease;
         snot.add(!fml);
         s.add(fml);
 
         while (snot.check() == z3::sat) {
             z3::expr clause = implicant(atms, s, snot);
-            cnf_clauses.push_back(clause.simplify());
+            if (!visit(clause.simplify())) return false;
             snot.add(clause);
         }
+        return true;
+    }
+
+    bool
+    Logic::to_cnf_bounded(const z3::expr& fml, z3::expr_vector& clauses) {
+        return for_each_cnf_clause(fml, [&](const z3::expr& clause) {
+            if (clause_limit != 0 && clauses.size() >= clause_limit) return false;
+            clauses.push_back(clause);
+            return true;
+        });
+    }
+
+    z3::expr_vector
+    Logic::to_cnf(const z3::expr& fml) {
+        z3::expr_vector cnf_clauses(fml.ctx());
+        if (!to_cnf_bounded(fml, cnf_clauses)) {
+            spdlog::debug("CNF conversion stopped at {} clauses", clause_limit);
+            truncated = true;
+        }
         return cnf_clauses;
     }
 
@@ -553,20 +740,31 @@ namespace ari_exe {
 
 
 
-    z3::expr_vector
-    Logic::to_dnf(const z3::expr& fml) {
+    bool
+    Logic::for_each_dnf_cube(const z3::expr& fml, const std::function<bool(const z3::expr&)>& visit) {
         // S <=> ((a1 ^ .. ^ a_n || ... ||  b1 ^ .. ^ b_m))
         // not S <=> ((!a1 || ... || !a_n) && ... && (!b1 || ... || !b_m))
-        auto neg_fml = to_cnf(!fml);
-        z3::params p(fml.ctx());
-        z3::expr_vector res(fml.ctx());
-        for (auto clause : neg_fml) {
+        return for_each_cnf_clause(!fml, [&](const z3::expr& clause) {
             auto clause_list = clause2list(clause);
             z3::expr_vector neg_clause_list(fml.ctx());
             for (auto lit : clause_list) {
                 neg_clause_list.push_back(!lit);
             }
-            res.push_back(z3::mk_and(neg_clause_list));
+            return visit(z3::mk_and(neg_clause_list));
+        });
+    }
+
+    z3::expr_vector
+    Logic::to_dnf(const z3::expr& fml) {
+        z3::expr_vector res(fml.ctx());
+        bool complete = for_each_dnf_cube(fml, [&](const z3::expr& cube) {
+            if (clause_limit != 0 && res.size() >= clause_limit) return false;
+            res.push_back(cube);
+            return true;
+        });
+        if (!complete) {
+            spdlog::debug("DNF conversion stopped at {} cubes", clause_limit);
+            truncated = true;
         }
         return res;
     }
@@ -605,7 +803,8 @@ namespace ari_exe {
             assert(is_literal(clause));
         }
         z3::expr target_expr(ctx);
-        z3::solver s(constraints.ctx());
+        SolverPool::Lease lease(ctx);
+        auto& s = *lease;
         s.add(constraints);
         bool found = false;
         z3::expr_vector eqs(ctx);
@@ -719,11 +918,21 @@ namespace ari_exe {
 
     z3::expr
     Logic::simplify(const z3::expr& fml) {
-        auto cnf = to_cnf(fml);
+        auto cache = SimplifyCache::get_instance();
+        if (auto cached = cache->lookup(SimplifyCache::CNF, fml)) {
+            return *cached;
+        }
+        z3::expr_vector cnf(fml.ctx());
+        if (!to_cnf_bounded(fml, cnf)) {
+            // a prefix of the CNF is weaker than fml, fall back to the plain rewriter
+            return fml.simplify();
+        }
         z3::expr_vector res(fml.ctx());
         for (auto clause : cnf) {
             res.push_back(clause.simplify());
         }
-        return z3::mk_and(res);
+        auto simplified = z3::mk_and(res);
+        cache->insert(SimplifyCache::CNF, fml, std::nullopt, simplified);
+        return simplified;
     }
 }
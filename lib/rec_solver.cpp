@@ -1,4 +1,5 @@
 #include "rec_solver.h"
+#include "common.h"
 #include <cerrno>
 #include <chrono>
 #include <csignal>
@@ -41,29 +42,6 @@ namespace {
             using std::runtime_error::runtime_error;
     };
 
-    bool env_flag(const char* name, bool default_value = false) {
-        const char* raw = std::getenv(name);
-        if (raw == nullptr || raw[0] == '\0') return default_value;
-        std::string value(raw);
-        return value != "0" && value != "false" && value != "False" &&
-               value != "no" && value != "off";
-    }
-
-    int env_int(const char* name, int default_value) {
-        const char* raw = std::getenv(name);
-        if (raw == nullptr || raw[0] == '\0') return default_value;
-        try {
-            return std::stoi(raw);
-        } catch (...) {
-            return default_value;
-        }
-    }
-
-    std::string env_string(const char* name) {
-        const char* raw = std::getenv(name);
-        return raw == nullptr ? "" : raw;
-    }
-
     std::string shell_quote(const std::string& value) {
         std::string quoted = "'";
         for (char ch : value) {
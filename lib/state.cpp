@@ -1,4 +1,5 @@
 #include "state.h"
+#include "logics.h"
 #include "spdlog/spdlog.h"
 
 using namespace ari_exe;
@@ -47,7 +48,7 @@ State::evaluate(llvm::Value* v, bool is_signed) {
         else
             return Expression(z3ctx.int_val(constant->getZExtValue()));
     }
-    auto obj = memory.get_object(v);
+    auto obj = memory.peek_object(v);
     if (obj) {
         auto res = obj->read().as_expr();
         return res;
@@ -71,7 +72,8 @@ State::get_model() {
     if (model.has_value()) {
         return model.value();
     }
-    auto evaluator = z3::solver(z3ctx);
+    SolverPool::Lease lease(z3ctx);
+    auto& evaluator = *lease;
     evaluator.add(get_path_condition().as_expr());
     auto is_sat = evaluator.check();
     assert(is_sat && "Path condition is not satisfiable, this state should not be created");
@@ -79,12 +81,35 @@ State::get_model() {
     return model.value();
 }
 
-bool
-State::is_concrete(const Expression& e, const Expression& concrete_value) {
-    auto evaluator = z3::solver(z3ctx);
+std::optional<std::vector<z3::expr>>
+State::get_concrete_ints(const std::vector<Expression>& values) {
+    std::vector<z3::expr> res;
+    std::vector<size_t> symbolic;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (auto value = values[i].get_concrete_int()) {
+            res.push_back(z3ctx.int_val(*value));
+            continue;
+        }
+        auto value = values[i].as_expr();
+        if (!value.is_int()) return std::nullopt;
+        if (!value.is_numeral()) symbolic.push_back(i);
+        res.push_back(value);
+    }
+    if (symbolic.empty()) return res;
+
+    auto candidates = get_model();
+    z3::expr_vector differs(z3ctx);
+    for (auto i : symbolic) {
+        auto candidate = candidates.eval(res[i], true);
+        if (!candidate.is_numeral()) return std::nullopt;
+        differs.push_back(res[i] != candidate);
+        res[i] = candidate;
+    }
+    SolverPool::Lease lease(z3ctx);
+    auto& evaluator = *lease;
     evaluator.add(get_path_condition().as_expr());
-    evaluator.add(concrete_value.as_expr() != e.as_expr());
-    auto res = evaluator.check() == z3::check_result::unsat;
+    evaluator.add(z3::mk_or(differs));
+    if (evaluator.check() != z3::unsat) return std::nullopt;
     return res;
 }
 
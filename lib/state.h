@@ -12,6 +12,7 @@
 
 #include "Memory.h"
 #include "Expr.h"
+#include "MemoryAccounting.h"
 
 namespace llvm {
     class Loop;
@@ -76,11 +77,14 @@ namespace ari_exe {
                 REACH_ERROR,    // reach an error state (call reach_error())
                 UNKNOWN,
                 FAIL,
+                BOUNDED,        // cut at the unrolling bound of a loop that cannot be summarized
             };
 
         public:
-            State(z3::context& z3ctx, AInstruction* pc, AInstruction* prev_pc, const Memory& memory, const Expression& path_condition, const trace_ty& trace, Status status = RUNNING): z3ctx(z3ctx), pc(pc), prev_pc(prev_pc), memory(memory), path_condition(path_condition), trace(trace), status(status) {};
-            State(const State& state): z3ctx(state.z3ctx), pc(state.pc), prev_pc(state.prev_pc), memory(state.memory), path_condition(state.path_condition), trace(state.trace), status(state.status), verification_condition(state.verification_condition), is_over_approx(state.is_over_approx), nondet_calls(state.nondet_calls), counterexample_complete(state.counterexample_complete), loop_certificates(state.loop_certificates), function_certificates(state.function_certificates) {};
+            State(z3::context& z3ctx, AInstruction* pc, AInstruction* prev_pc, const Memory& memory, const Expression& path_condition, const trace_ty& trace, Status status = RUNNING): z3ctx(z3ctx), pc(pc), prev_pc(prev_pc), memory(memory), path_condition(path_condition), trace(trace), status(status) { MemoryAccounting::on_state_created(); };
+            State(const State& state): z3ctx(state.z3ctx), pc(state.pc), prev_pc(state.prev_pc), memory(state.memory), path_condition(state.path_condition), trace(state.trace), status(state.status), verification_condition(state.verification_condition), is_over_approx(state.is_over_approx), nondet_calls(state.nondet_calls), counterexample_complete(state.counterexample_complete), loop_certificates(state.loop_certificates), function_certificates(state.function_certificates), unrolled_iterations(state.unrolled_iterations), symbolic_exits(state.symbolic_exits) { MemoryAccounting::on_state_created(); };
+
+            virtual ~State() { MemoryAccounting::on_state_destroyed(); }
 
             // if the state is in the process of summarizing a loop
             virtual bool is_summarizing() const { return false; }
@@ -88,9 +92,11 @@ namespace ari_exe {
             virtual void append_path_condition(const Expression& _path_condition);
 
             /**
-             * @brief check if the given e is concrete and equal to concrete_value in the current state
+             * @brief the integer numerals the values are equal to on this path, nullopt if some value is not unique.
+             *        Numerals are recognized syntactically, the other values are checked together
+             *        by a single query against their values in a model of the path condition.
              */
-            bool is_concrete(const Expression& e, const Expression& concrete_value);
+            std::optional<std::vector<z3::expr>> get_concrete_ints(const std::vector<Expression>& values);
 
             // step the pc
             void step_pc(AInstruction* next_pc = nullptr);
@@ -149,6 +155,15 @@ namespace ari_exe {
             // Exact recursive summaries encountered on this path. These are
             // converted to source-level function contracts.
             std::vector<FunctionCertificate> function_certificates;
+
+            // The iterations of loops that cannot be summarized, unrolled on
+            // this path since the loops were entered, whose exit branches
+            // forked on symbolic conditions.
+            std::map<llvm::Loop*, unsigned> unrolled_iterations;
+
+            // The loops whose exit branches forked on symbolic conditions in
+            // the current iteration on this path.
+            std::set<llvm::Loop*> symbolic_exits;
     };
 
     class LoopState: public State {
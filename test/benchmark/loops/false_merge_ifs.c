@@ -0,0 +1,22 @@
+#include "assert.h"
+
+int main() {
+    int n = __VERIFIER_nondet_int();
+    int p = __VERIFIER_nondet_int();
+    int q = __VERIFIER_nondet_int();
+    int i = 0;
+    int a = 0;
+    int b = 0;
+
+    // the same body as true_merge_ifs.c, the assertion fails only if
+    // the else side of the diamond and the triangle are both taken
+    while (i < n) {
+        if (p > 0) a = a + 1;
+        else a = a + 2;
+        if (q > 0) b = b + 3;
+        i = i + 1;
+    }
+
+    __VERIFIER_assert(i == 0 || a + b < 5 * i);
+    return 0;
+}
@@ -0,0 +1,23 @@
+#include "assert.h"
+
+int main() {
+    int a = __VERIFIER_nondet_int();
+    int b = __VERIFIER_nondet_int();
+    int c = __VERIFIER_nondet_int();
+    int u = 0;
+    // the paths reaching the loop differ only in u and in conditions on a, b and c
+    if (a > 0) u = u + 1;
+    if (b > 0) u = u + 2;
+    if (c > 0) u = u + 4;
+
+    int i = 0;
+    int s = 0;
+    while (i < 10) {
+        s = s + 2;
+        i = i + 1;
+    }
+
+    __VERIFIER_assert(s == 20);
+    __VERIFIER_assert(u < 8);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "assert.h"
+
+int main() {
+    int n = __VERIFIER_nondet_int();
+    int i = 0;
+    int x = 0;
+    int y = 0;
+
+    while (i < n) {
+        // the inner loop does not access y, so both paths share its summary
+        if (n > 10) y = y + 2;
+        else y = y + 1;
+        int j = 0;
+        int t = 0;
+        while (j < 3) {
+            t = t + 2;
+            j = j + 1;
+        }
+        x = x + t;
+        i = i + 1;
+    }
+
+    __VERIFIER_assert(x == 6 * i);
+    return 0;
+}
@@ -0,0 +1,31 @@
+extern void abort(void);
+extern void __assert_fail(const char *, const char *, unsigned int,
+                          const char *) __attribute__((noreturn));
+
+void reach_error(void) {
+    __assert_fail("0", "true_unroll_bounded.c", 6, "reach_error");
+}
+
+void __VERIFIER_assert(int condition) {
+    if (!condition) {
+        reach_error();
+        abort();
+    }
+}
+
+extern int __VERIFIER_nondet_int(void);
+
+int main(void) {
+    int n = __VERIFIER_nondet_int();
+    int x = 0;
+    int y = 0;
+    int i = 0;
+    // y < 10 holds since x stays 0, but no k-induction proves it without x == 0
+    while (i < n) {
+        x = x * x;
+        y = y + x;
+        ++i;
+        __VERIFIER_assert(y < 10);
+    }
+    return 0;
+}
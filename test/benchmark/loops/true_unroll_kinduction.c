@@ -0,0 +1,29 @@
+extern void abort(void);
+extern void __assert_fail(const char *, const char *, unsigned int,
+                          const char *) __attribute__((noreturn));
+
+void reach_error(void) {
+    __assert_fail("0", "true_unroll_kinduction.c", 6, "reach_error");
+}
+
+void __VERIFIER_assert(int condition) {
+    if (!condition) {
+        reach_error();
+        abort();
+    }
+}
+
+extern int __VERIFIER_nondet_int(void);
+
+int main(void) {
+    int n = __VERIFIER_nondet_int();
+    int x = 1;
+    int i = 0;
+    // the square has no closed form, and the assertion is 1-inductive
+    while (i < n) {
+        x = x * x + 1;
+        ++i;
+        __VERIFIER_assert(x > 0);
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+extern void abort(void);
+extern void __assert_fail(const char *, const char *, unsigned int, const char *) __attribute__ ((__nothrow__ , __leaf__)) __attribute__ ((__noreturn__));
+void reach_error() { __assert_fail("0", "true_callee_summary.c", 3, "reach_error"); }
+
+/*
+ * The summary of sum is computed against the summary of its recursive callee dec.
+ * Neither recursion is a tail call, so both stay recursive.
+ */
+
+extern int __VERIFIER_nondet_int(void);
+
+void __VERIFIER_assert(int cond) {
+    if (!(cond)) {
+    ERROR:
+        {reach_error();}
+    }
+    return;
+}
+
+// returns -n for n >= 0
+int dec(int n) {
+    if (n <= 0) {
+        return 0;
+    }
+    return dec(n - 1) - 1;
+}
+
+// returns 1 + 2 + ... + n for n >= 0
+int sum(int n) {
+    if (n <= 0) {
+        return 0;
+    }
+    return sum(n - 1) - dec(n);
+}
+
+int main() {
+    int n = __VERIFIER_nondet_int();
+    if (n < 0 || n > 1000) {
+        return 0;
+    }
+    int result = sum(n);
+    __VERIFIER_assert(2 * result == n * (n + 1));
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "LinearAlgebra.h"
+#include "ClosedFormKernel.h"
 
 // TEST(LinearAlgebra, MatrixAddition) {
 //     ari_exe::Algebra::LinearAlgebra::Matrix<int> A(2, 2);
@@ -111,6 +112,34 @@ TEST(LinearAlgebra, SolveNumericZ3) {
     EXPECT_EQ(C(1, 0).simplify().to_string(), "8");
 }
 
+TEST(ClosedFormKernel, EvaluatePolynomialAndExponential) {
+    z3::context ctx;
+    auto x = ctx.int_const("x");
+    auto n = ctx.int_const("n");
+    z3::expr_vector variables(ctx);
+    variables.push_back(x);
+    variables.push_back(n);
+    auto kernel = ari_exe::ClosedFormKernel::compile(x + n * (n + 1) / 2 + z3::pw(ctx.int_val(2), n), variables);
+    ASSERT_TRUE(kernel.has_value());
+    auto value = kernel->evaluate({ari_exe::Rational(ari_exe::BigInt(-3)), ari_exe::Rational(ari_exe::BigInt(100))});
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value->to_string(), "1267650600228229401496703210423");
+}
+
+TEST(ClosedFormKernel, EvaluateRationalsAndIntegerDivision) {
+    z3::context ctx;
+    auto x = ctx.int_const("x");
+    z3::expr_vector variables(ctx);
+    variables.push_back(x);
+    auto rational = ari_exe::ClosedFormKernel::compile(z3::to_real(x) / 6 + ctx.real_val("1/2"), variables);
+    ASSERT_TRUE(rational.has_value());
+    EXPECT_EQ(rational->evaluate({ari_exe::Rational(ari_exe::BigInt(7))})->to_string(), "5/3");
+    auto division = ari_exe::ClosedFormKernel::compile(x / 7 + x % 7, variables);
+    ASSERT_TRUE(division.has_value());
+    EXPECT_EQ(division->evaluate({ari_exe::Rational(ari_exe::BigInt(-100))})->to_string(), "-10");
+    EXPECT_FALSE(division->evaluate({std::nullopt}).has_value());
+}
+
 // TEST(LinearAlgebra, MatrixLUDecomposition) {
 //     ari_exe::Algebra::LinearAlgebra::Matrix<double> A(3, 3);
 //     A(0, 0) = 1; A(0, 1) = 1; A(0, 2) = 1;
@@ -2,6 +2,7 @@
 #include <string>
 #include "engine.h"
 #include "AInstruction.h"
+#include "logics.h"
 #include "z3++.h"
 
 using namespace ari_exe;
@@ -28,12 +29,13 @@ void reset_test_caches() {
     }
     AInstruction::cached_instructions.clear();
     AInstructionPhi::failed_loops.clear();
-    AnalysisManager::unknown_counter = 0;
 
     delete State::func_summaries;
     State::func_summaries = new SymbolTable<FunctionSummary>();
     delete State::loop_summaries;
     State::loop_summaries = new SymbolTable<LoopSummary>();
+    SimplifyCache::get_instance()->clear();
+    Cache::get_instance()->clear();
 }
 
 BenchmarkRun run_benchmark(const std::string& relative_path) {
@@ -226,6 +228,49 @@ TEST(BENCHMARK_LOOPS, true_9) {
     EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_9.c";
 }
 
+TEST(BENCHMARK_LOOPS, true_unroll_kinduction) {
+    auto veri_res = verify_benchmark("loops/true_unroll_kinduction.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_unroll_kinduction.c";
+}
+
+TEST(BENCHMARK_LOOPS, true_unroll_bounded) {
+    auto run = run_benchmark("loops/true_unroll_bounded.c");
+    EXPECT_EQ(run.result, VERIUNKNOWN) << "Failed on: benchmark/loops/true_unroll_bounded.c";
+    EXPECT_TRUE(run.has_issue);
+    EXPECT_EQ(run.issue_kind, VerifierIssueKind::UnrollBound);
+}
+
+TEST(BENCHMARK_LOOPS, true_unroll_concrete) {
+    auto veri_res = verify_benchmark("loops/true_unroll_concrete.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_unroll_concrete.c";
+}
+
+TEST(BENCHMARK_LOOPS, true_merge_ifs) {
+    auto veri_res = verify_benchmark("loops/true_merge_ifs.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_merge_ifs.c";
+}
+
+TEST(BENCHMARK_LOOPS, false_merge_ifs) {
+    auto veri_res = verify_benchmark("loops/false_merge_ifs.c");
+    EXPECT_EQ(veri_res, FAIL) << "Failed on: benchmark/loops/false_merge_ifs.c";
+}
+
+TEST(BENCHMARK_LOOPS, true_summary_reuse) {
+    auto summarized = LoopSummarizer::get_summarized_count();
+    auto veri_res = verify_benchmark("loops/true_summary_reuse.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_summary_reuse.c";
+    // the loop is summarized once for all paths of the branches before it
+    EXPECT_EQ(LoopSummarizer::get_summarized_count() - summarized, 1);
+}
+
+TEST(BENCHMARK_LOOPS, true_summary_reuse_nested) {
+    auto summarized = LoopSummarizer::get_summarized_count();
+    auto veri_res = verify_benchmark("loops/true_summary_reuse_nested.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/loops/true_summary_reuse_nested.c";
+    // the outer loop, and the inner loop once for both paths of the outer body
+    EXPECT_EQ(LoopSummarizer::get_summarized_count() - summarized, 2);
+}
+
 TEST(BENCHMARK_PTR, false_1) {
     auto veri_res = verify_benchmark("ptr/false_1.c");
     EXPECT_EQ(veri_res, FAIL) << "Failed on: benchmark/ptr/false_1.c";
@@ -321,6 +366,21 @@ TEST(BENCHMARK_RECURSION, true_9) {
     EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/recursion/true_9.c";
 }
 
+TEST(BENCHMARK_RECURSION, true_add) {
+    auto veri_res = verify_benchmark("recursion/true_add.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/recursion/true_add.c";
+}
+
+TEST(BENCHMARK_RECURSION, true_callee_summary) {
+    auto veri_res = verify_benchmark("recursion/true_callee_summary.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/recursion/true_callee_summary.c";
+}
+
+TEST(BENCHMARK_RECURSION, true_distri) {
+    auto veri_res = verify_benchmark("recursion/true_distri.c");
+    EXPECT_EQ(veri_res, HOLD) << "Failed on: benchmark/recursion/true_distri.c";
+}
+
 TEST(BENCHMARK_BOUNDED_CFINITE, bcf_01_square_invariant) {
     run_bounded_cfinite_benchmark("bcf_01_square_invariant_bmax.c");
 }
@@ -2,6 +2,14 @@
 #include "z3++.h"
 
 #include "logics.h"
+#include "Expr.h"
+#include "cache.h"
+#include "MemoryObject.h"
+
+#include <cstdio>
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/IRBuilder.h"
 
 using namespace ari_exe;
 
@@ -65,4 +73,287 @@ TEST(ITE2PIECEWISE, test_1) {
 
     z3::expr ite_expr = piecewise2ite(conditions2, expressions2);
     EXPECT_TRUE(is_equivalent(ite_expr, expr2));
-}
\ No newline at end of file
+}
+
+TEST(SIMPLIFY_CACHE, test_1) {
+    auto& z3_ctx = AnalysisManager::get_ctx();
+    auto cache = SimplifyCache::get_instance();
+    cache->clear();
+    z3::expr x = z3_ctx.int_const("x");
+    z3::expr fml = x > 0 && (x > 1 || x <= 1);
+
+    auto first = simplify(fml, x > 2);
+    EXPECT_EQ(cache->get_misses(SimplifyCache::CONTEXTUAL), 1);
+    auto second = simplify(fml, x > 2);
+    EXPECT_EQ(cache->get_hits(SimplifyCache::CONTEXTUAL), 1);
+    EXPECT_TRUE(z3::eq(first, second));
+
+    // a different assumption must not hit the entry above
+    simplify(fml, x > 3);
+    EXPECT_EQ(cache->get_hits(SimplifyCache::CONTEXTUAL), 1);
+
+    cache->set_capacity(0);
+    EXPECT_EQ(cache->size(), 0);
+    cache->set_capacity(4096);
+    cache->clear();
+}
+
+TEST(FUNC_CACHE, test_1) {
+    llvm::LLVMContext llvm_ctx;
+    llvm::Module module("func_cache", llvm_ctx);
+    auto i64 = llvm::Type::getInt64Ty(llvm_ctx);
+    auto func_type = llvm::FunctionType::get(i64, {i64, i64}, false);
+    auto func = llvm::Function::Create(func_type, llvm::Function::ExternalLinkage, "gcd", module);
+    // gcd returns what its callee reads from a global
+    auto global = new llvm::GlobalVariable(module, i64, false, llvm::GlobalValue::ExternalLinkage, llvm::ConstantInt::get(i64, 1), "g");
+    auto callee = llvm::Function::Create(llvm::FunctionType::get(i64, false), llvm::Function::ExternalLinkage, "read", module);
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(llvm_ctx, "entry", callee));
+    builder.CreateRet(builder.CreateLoad(i64, global));
+    builder.SetInsertPoint(llvm::BasicBlock::Create(llvm_ctx, "entry", func));
+    builder.CreateRet(builder.CreateCall(callee));
+
+    auto cache = Cache::get_instance();
+    cache->clear();
+    z3::context z3_ctx;
+    auto big = *Cache::from_numeral(z3_ctx.int_val("123456789012345678901234567890"));
+    EXPECT_TRUE(std::holds_alternative<std::string>(big));
+    param_list_ty args{int64_t(12), big};
+    EXPECT_FALSE(cache->get_func_value(func, args).has_value());
+    cache->cache_func_value(func, args, {int64_t(6)});
+    auto value = cache->get_func_value(func, args);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_TRUE(z3::eq(Cache::to_numeral(z3_ctx, value->front()), z3_ctx.int_val(6)));
+    EXPECT_EQ(cache->get_hits(func), 1);
+    EXPECT_EQ(cache->get_misses(func), 1);
+
+    // the least recently used entry is evicted first
+    cache->cache_func_value(func, {int64_t(1), int64_t(2)}, {int64_t(1)});
+    cache->get_func_value(func, args);
+    cache->set_capacity(1);
+    EXPECT_EQ(cache->size(), 1);
+    EXPECT_TRUE(cache->get_func_value(func, args).has_value());
+    EXPECT_FALSE(cache->get_func_value(func, {int64_t(1), int64_t(2)}).has_value());
+    cache->set_capacity(65536);
+
+    // entries are reloaded for the same function
+    auto path = testing::TempDir() + "func_cache.txt";
+    ASSERT_TRUE(cache->save(path, module));
+    cache->clear();
+    ASSERT_TRUE(cache->load(path));
+    value = cache->get_func_value(func, args);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_TRUE(std::holds_alternative<int64_t>(value->front()));
+    EXPECT_EQ(std::get<int64_t>(value->front()), 6);
+
+    // but not once a global read by a callee changes
+    ASSERT_TRUE(cache->save(path, module));
+    cache->clear();
+    global->setInitializer(llvm::ConstantInt::get(i64, 2));
+    ASSERT_TRUE(cache->load(path));
+    EXPECT_FALSE(cache->get_func_value(func, args).has_value());
+
+    // the stale entries are not saved again
+    ASSERT_TRUE(cache->save(path, module));
+    cache->clear();
+    global->setInitializer(llvm::ConstantInt::get(i64, 1));
+    ASSERT_TRUE(cache->load(path));
+    EXPECT_FALSE(cache->get_func_value(func, args).has_value());
+
+    // at most as many entries as the capacity are saved, and the loaded entries not used yet
+    // were used before the others
+    cache->clear();
+    cache->cache_func_value(callee, {}, {int64_t(1)});
+    ASSERT_TRUE(cache->save(path, module));
+    cache->clear();
+    ASSERT_TRUE(cache->load(path));
+    cache->set_capacity(1);
+    cache->cache_func_value(func, args, {int64_t(6)});
+    ASSERT_TRUE(cache->save(path, module));
+    cache->clear();
+    cache->set_capacity(65536);
+    ASSERT_TRUE(cache->load(path));
+    EXPECT_TRUE(cache->get_func_value(func, args).has_value());
+    EXPECT_FALSE(cache->get_func_value(callee, {}).has_value());
+    std::remove(path.c_str());
+    cache->clear();
+}
+
+TEST(NORMAL_FORM_LIMIT, test_1) {
+    auto z3_ctx = z3::context();
+    z3::expr x = z3_ctx.int_const("x");
+    z3::expr y = z3_ctx.int_const("y");
+    z3::expr fml = x > 0 && y > 0;
+
+    Logic bounded(1);
+    auto cnf = bounded.to_cnf(fml);
+    EXPECT_EQ(cnf.size(), 1);
+    EXPECT_TRUE(bounded.is_truncated());
+    // a truncated CNF over-approximates the formula
+    EXPECT_TRUE(ari_exe::implies(fml, z3::mk_and(cnf)));
+
+    Logic unbounded(0);
+    cnf = unbounded.to_cnf(fml);
+    EXPECT_FALSE(unbounded.is_truncated());
+    EXPECT_TRUE(is_equivalent(fml, z3::mk_and(cnf)));
+}
+
+TEST(SOLVER_POOL, test_1) {
+    auto& z3_ctx = AnalysisManager::get_ctx();
+    auto& pool = SolverPool::get_instance();
+    pool.clear();
+    z3::expr x = z3_ctx.int_const("x");
+
+    EXPECT_TRUE(is_feasible(x > 0));
+    EXPECT_EQ(pool.get_constructed(), 1);
+    // the solver used above is returned without assertions and reused
+    EXPECT_FALSE(is_feasible(x < 0, x > 0));
+    EXPECT_TRUE(ari_exe::implies(x > 1, x > 0));
+    EXPECT_EQ(pool.get_constructed(), 1);
+    EXPECT_EQ(pool.get_reused(), 2);
+    {
+        SolverPool::Lease lease(z3_ctx);
+        EXPECT_EQ(lease->assertions().size(), 0);
+        lease->push();
+        lease->add(x < 0);
+    }
+    {
+        SolverPool::Lease lease(z3_ctx);
+        EXPECT_EQ(lease->assertions().size(), 0);
+        EXPECT_EQ(lease->check(), z3::sat);
+    }
+
+    // solvers of other contexts are not pooled
+    auto local_ctx = z3::context();
+    EXPECT_TRUE(is_feasible(local_ctx.int_const("y") > 0));
+    EXPECT_EQ(pool.get_reused(), 4);
+    pool.clear();
+}
+
+TEST(CONSTANT_FOLDING, test_1) {
+    auto& z3_ctx = AnalysisManager::get_ctx();
+    Expression a(z3_ctx.int_val(-7));
+    Expression b(z3_ctx.int_val(2));
+    EXPECT_TRUE((a + b).as_expr().is_numeral());
+    EXPECT_EQ((a * b).as_expr().get_numeral_int64(), -14);
+    // division and remainder follow the semantics of z3
+    EXPECT_EQ((a / b).as_expr().get_numeral_int64(), -4);
+    EXPECT_EQ((a % b).as_expr().get_numeral_int64(), 1);
+    EXPECT_TRUE((a < b).as_expr().is_true());
+    EXPECT_TRUE((!(a == b)).as_expr().is_true());
+
+    // symbolic operands are left to z3
+    Expression x(z3_ctx.int_const("x"));
+    EXPECT_FALSE((x + b).as_expr().is_numeral());
+
+    EXPECT_EQ((a < b).get_concrete_truth(), std::optional<bool>(true));
+    EXPECT_EQ(a.get_concrete_truth(), std::optional<bool>(true));
+    EXPECT_FALSE((x < b).get_concrete_truth().has_value());
+}
+
+TEST(NAME_SERVICE, test_1) {
+    llvm::LLVMContext llvm_ctx;
+    auto value = llvm::UndefValue::get(llvm::Type::getInt32Ty(llvm_ctx));
+    auto& names = AnalysisManager::get_names();
+    names.reset();
+    EXPECT_EQ(names.fresh_name(value, "_unknown_"), "ari__unknown_0");
+    EXPECT_EQ(names.fresh_name(value, "_unknown_"), "ari__unknown_1");
+
+    EXPECT_EQ(names.next_id(value), 2);
+
+    // symbols are interned once per value
+    EXPECT_EQ(names.symbol(value).str(), names.z3_name(value));
+    EXPECT_TRUE(z3::eq(names.int_const(value), AnalysisManager::get_ctx().int_const(names.z3_name(value).c_str())));
+    EXPECT_EQ(names.int_function(value).arity(), 1);
+
+    // loading a new module drops the cached names but never repeats a fresh name
+    names.forget_values();
+    EXPECT_EQ(names.fresh_name(value, "_unknown_"), "ari__unknown_3");
+
+    // every context has its own service
+    z3::context local_ctx;
+    NameService local_names(local_ctx);
+    EXPECT_EQ(local_names.fresh_name(value, "_unknown_"), "ari__unknown_0");
+    EXPECT_TRUE(z3::eq(local_names.int_const(value), local_ctx.int_const("ari_")));
+    names.reset();
+}
+
+// an array a of size 16 whose initial content is the function init
+static MemoryObject
+make_array(z3::context& ctx, const z3::expr& i) {
+    z3::expr_vector indices(ctx);
+    indices.push_back(i);
+    auto init = ctx.function("init", ctx.int_sort(), ctx.int_sort());
+    MemoryAddress_ty addr{STACK, Expression(ctx.int_val(0)), {}};
+    return MemoryObject(nullptr, addr, Expression(init(i)), std::nullopt, indices, {Expression(ctx.int_val(16))}, "a");
+}
+
+static bool
+is_valid(z3::context& ctx, const z3::expr& e) {
+    z3::solver solver(ctx);
+    solver.add(!e);
+    return solver.check() == z3::unsat;
+}
+
+TEST(MEMORY_OBJECT, array_backend) {
+    auto& ctx = AnalysisManager::get_ctx();
+    auto i = ctx.int_const("i");
+    auto j = ctx.int_const("j");
+    auto init = ctx.function("init", ctx.int_sort(), ctx.int_sort());
+    auto at = [&](int k) { return std::vector<Expression>{Expression(ctx.int_val(k))}; };
+
+    // switches after 16 writes at concrete indices, unless ARITHEXE_ARRAY_THEORY_THRESHOLD says otherwise
+    auto array = make_array(ctx, i);
+    for (int k = 0; k < 15; ++k) array.write(at(k), Expression(ctx.int_val(k)));
+    if (std::getenv("ARITHEXE_ARRAY_THEORY_THRESHOLD") == nullptr) {
+        EXPECT_EQ(array.get_array_backend(), MemoryObject::PIECEWISE);
+        array.write(at(15), Expression(ctx.int_val(15)));
+        EXPECT_EQ(array.get_array_backend(), MemoryObject::THEORY);
+    }
+
+    // a few writes before switching keep the reads below cheap
+    array = make_array(ctx, i);
+    for (int k = 0; k < 4; ++k) array.write(at(k), Expression(ctx.int_val(k)));
+    array.set_array_backend(MemoryObject::THEORY);
+    EXPECT_EQ(array.read(at(3)).as_expr().simplify().get_numeral_int(), 3);
+
+    // the latest write at the same concrete index wins
+    array.write(at(3), Expression(ctx.int_val(100)));
+    EXPECT_EQ(array.read(at(3)).as_expr().simplify().get_numeral_int(), 100);
+
+    // reads at a symbolic index see the stores and the content before switching
+    auto read_j = array.read({Expression(j)}).as_expr();
+    EXPECT_TRUE(is_valid(ctx, z3::implies(j == 3, read_j == 100)));
+    EXPECT_TRUE(is_valid(ctx, z3::implies(j == 2, read_j == 2)));
+    EXPECT_TRUE(is_valid(ctx, z3::implies(j == 20, read_j == init(20))));
+
+    // the materialized value is cached until the next write
+    EXPECT_TRUE(z3::eq(array.get_value().as_expr(), array.get_value().as_expr()));
+    array.write(at(4), Expression(ctx.int_val(200)));
+    EXPECT_TRUE(is_valid(ctx, z3::implies(i == 4, array.get_value().as_expr() == 200)));
+}
+
+TEST(MEMORY_OBJECT, materialize) {
+    auto& ctx = AnalysisManager::get_ctx();
+    auto i = ctx.int_const("i");
+    auto j = ctx.int_const("j");
+
+    // the same writes, including one at a symbolic index, on both backends
+    auto piecewise = make_array(ctx, i);
+    auto theory = make_array(ctx, i);
+    theory.set_array_backend(MemoryObject::THEORY);
+    std::vector<std::pair<Expression, int>> writes = {
+        {Expression(ctx.int_val(1)), 10}, {Expression(j), 20}, {Expression(ctx.int_val(2)), 30},
+        {Expression(ctx.int_val(1)), 40}, {Expression(j + 1), 50},
+    };
+    for (const auto& [index, v] : writes) {
+        piecewise.write({index}, Expression(ctx.int_val(v)));
+        theory.write({index}, Expression(ctx.int_val(v)));
+    }
+    EXPECT_EQ(piecewise.get_array_backend(), MemoryObject::PIECEWISE);
+    EXPECT_EQ(theory.get_array_backend(), MemoryObject::THEORY);
+    EXPECT_TRUE(is_valid(ctx, piecewise.get_value().as_expr() == theory.get_value().as_expr()));
+
+    // switching back keeps the content
+    theory.set_array_backend(MemoryObject::PIECEWISE);
+    EXPECT_TRUE(is_valid(ctx, piecewise.get_value().as_expr() == theory.get_value().as_expr()));
+}
@@ -26,7 +26,6 @@ void reset_caches() {
     }
     AInstruction::cached_instructions.clear();
     AInstructionPhi::failed_loops.clear();
-    AnalysisManager::unknown_counter = 0;
 
     delete State::func_summaries;
     State::func_summaries = new SymbolTable<FunctionSummary>();